@@ -0,0 +1,13 @@
+QT = core network
+
+TEMPLATE = app
+
+TARGET = idle-benchmark
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../qtirc-core-sources.pri)
+
+SOURCES += \
+    main.cpp
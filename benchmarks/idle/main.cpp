@@ -0,0 +1,228 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Measures what an idle connection costs. The program starts a copy of
+// itself as a minimal server, which only welcomes clients and answers
+// their lag checks, so its work does not count. It then compares the
+// resident memory and the context switches of all threads of this process
+// without clients and with the given number of idle, logged in clients.
+// Context switches stand in for wakeups. Both are read from /proc, so this
+// only runs on Linux.
+//
+// Usage: idle-benchmark [clients] [seconds] [threads]
+
+// Own includes
+#include "../../ircconnectionmanager.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+
+/** Welcomes every client and answers its pings, nothing else. */
+class IdleServer :
+        public QObject {
+    Q_OBJECT
+public:
+    IdleServer()
+    {
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(handleNewConnection()));
+    }
+
+    bool listen()
+    {
+        return m_server.listen(QHostAddress::LocalHost);
+    }
+
+    quint16 port() const
+    {
+        return m_server.serverPort();
+    }
+
+private slots:
+    void handleNewConnection()
+    {
+        while(QTcpSocket *socket = m_server.nextPendingConnection())
+        {
+            connect(socket, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
+            connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        }
+    }
+
+    void handleReadyRead()
+    {
+        QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+        while(socket && socket->canReadLine())
+        {
+            QByteArray line = socket->readLine().trimmed();
+            int space = line.indexOf(' ');
+            QByteArray command = line.left(space);
+            QByteArray argument = space < 0 ? QByteArray() : line.mid(space + 1);
+            if(argument.startsWith(':'))
+                argument.remove(0, 1);
+
+            if(command == "NICK")
+                socket->setProperty("nick", argument);
+            else if(command == "USER")
+                socket->write(":idle.server 001 " + socket->property("nick").toByteArray()
+                              + " :Welcome\r\n");
+            else if(command == "PING")
+                socket->write(":idle.server PONG idle.server :" + argument + "\r\n");
+        }
+    }
+
+private:
+    QTcpServer m_server;
+};
+
+namespace {
+
+qint64
+residentKiB()
+{
+    QFile status("/proc/self/status");
+    if(!status.open(QIODevice::ReadOnly))
+        return -1;
+    foreach(const QByteArray &line, status.readAll().split('\n'))
+    {
+        if(line.startsWith("VmRSS:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+}
+
+quint64
+contextSwitches()
+{
+    quint64 switches = 0;
+    QDir tasks("/proc/self/task");
+    foreach(const QString &task, tasks.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QFile status(tasks.filePath(task) + "/status");
+        if(!status.open(QIODevice::ReadOnly))
+            continue;
+        foreach(const QByteArray &line, status.readAll().split('\n'))
+        {
+            if(line.startsWith("voluntary_ctxt_switches:")
+            || line.startsWith("nonvoluntary_ctxt_switches:"))
+                switches += line.mid(line.indexOf(':') + 1).trimmed().toULongLong();
+        }
+    }
+    return switches;
+}
+
+void
+runEventLoop(int milliseconds)
+{
+    QEventLoop loop;
+    QTimer::singleShot(milliseconds, &loop, SLOT(quit()));
+    loop.exec();
+}
+
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QStringList arguments = application.arguments();
+    QTextStream out(stdout);
+
+    if(arguments.contains("--server"))
+    {
+        IdleServer server;
+        if(!server.listen())
+            return 1;
+        out << server.port() << endl;
+        return application.exec();
+    }
+
+    const int clientCount = qMax(1, arguments.size() > 1 ? arguments.at(1).toInt() : 100);
+    const int seconds = qMax(1, arguments.size() > 2 ? arguments.at(2).toInt() : 120);
+    const int threadCount = arguments.size() > 3 ? arguments.at(3).toInt()
+                                                 : int(IRCConnectionManager::DefaultThreadCount);
+
+    // Keep the search indexes of the clients out of the real data location.
+    QStandardPaths::setTestModeEnabled(true);
+
+    QProcess serverProcess;
+    serverProcess.start(application.applicationFilePath(), QStringList("--server"));
+    if(!serverProcess.waitForReadyRead(10000))
+    {
+        out << "The server did not start.\n";
+        return 1;
+    }
+    const quint16 port = quint16(serverProcess.readLine().trimmed().toUInt());
+
+    IRCConnectionManager manager(threadCount);
+    runEventLoop(1000);
+
+    const qint64 baseResident = residentKiB();
+    quint64 switches = contextSwitches();
+    runEventLoop(seconds * 1000);
+    const double baseSwitches = double(contextSwitches() - switches) / seconds;
+
+    for(int i = 0; i < clientCount; i++)
+        manager.addClient()->connectToHost("127.0.0.1", port, QString("idle%1").arg(i));
+
+    int loggedIn = 0;
+    for(int attempt = 0; attempt < 300 && loggedIn < clientCount; attempt++)
+    {
+        runEventLoop(100);
+        loggedIn = 0;
+        foreach(IRCClient *client, manager.clients())
+            loggedIn += client->isLoggedIn() ? 1 : 0;
+    }
+    if(loggedIn < clientCount)
+    {
+        out << "Only " << loggedIn << " of " << clientCount << " clients logged in.\n";
+        return 1;
+    }
+
+    // Let the login traffic and its allocations settle.
+    runEventLoop(2000);
+    const qint64 resident = residentKiB();
+    switches = contextSwitches();
+    runEventLoop(seconds * 1000);
+    const double clientSwitches = double(contextSwitches() - switches) / seconds;
+
+    out << "threads: " << threadCount << ", clients: " << clientCount
+        << ", measured for " << seconds << " s each\n";
+    out << "resident: " << baseResident << " KiB without clients, "
+        << resident << " KiB with them, "
+        << QString::number(double(resident - baseResident) / clientCount, 'f', 1)
+        << " KiB per client\n";
+    out << "context switches: " << QString::number(baseSwitches, 'f', 2)
+        << " per second without clients, " << QString::number(clientSwitches, 'f', 2)
+        << " with them, " << QString::number((clientSwitches - baseSwitches) / clientCount * 60, 'f', 2)
+        << " per client and minute\n";
+
+    serverProcess.kill();
+    serverProcess.waitForFinished();
+    return 0;
+}
+
+#include "main.moc"
@@ -0,0 +1,130 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Appends messages to a channel conversation and reports how long that
+// took, for each way messages have been rendered:
+//
+//   html      a throwaway QTextEdit per message appending HTML, as before
+//             messages were rendered through a QTextCursor
+//   cursor    formatted text inserted through one QTextCursor
+//   channel   IRCChannel and IRCChannelDocument, including the log and the
+//             search index, with messages flushed in batches
+//
+// Usage: render-benchmark [messages] [batch size]
+
+// Own includes
+#include "../../ircclient.h"
+#include "../../ircchanneldocument.h"
+#include "../../ircnickformatcache.h"
+
+// Qt includes
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextEdit>
+#include <QTextStream>
+
+namespace {
+const char *Nicks[] = { "alice", "bob", "carol", "dave", "eve", "mallory", "trent" };
+const int NickCount = sizeof(Nicks) / sizeof(Nicks[0]);
+
+QString
+messageText(int number)
+{
+    return QString("message %1 about nothing in particular, long enough to wrap "
+                   "once in a narrow window").arg(number);
+}
+
+void
+report(QTextStream &out, const char *mode, int messageCount, qint64 nanoseconds)
+{
+    out << mode << ": " << messageCount << " messages in "
+        << QString::number(nanoseconds / 1e6, 'f', 1) << " ms, "
+        << QString::number(nanoseconds / 1e3 / messageCount, 'f', 2) << " us per message\n";
+    out.flush();
+}
+}
+
+int
+main(int argc, char *argv[])
+{
+    QApplication application(argc, argv);
+    QStringList arguments = application.arguments();
+    const int messageCount = qMax(1, arguments.size() > 1 ? arguments.at(1).toInt() : 10000);
+    const int batchSize = qMax(1, arguments.size() > 2 ? arguments.at(2).toInt() : 1);
+    QTextStream out(stdout);
+
+    IRCAtomTable atomTable;
+    IRCNickFormatCache nickFormatCache(&atomTable);
+    QElapsedTimer timer;
+
+    {
+        QTextDocument document;
+        timer.start();
+        for(int i = 0; i < messageCount; i++)
+        {
+            const QString nick = QLatin1String(Nicks[i % NickCount]);
+            QColor color = nickFormatCache.format(atomTable.intern(nick)).foreground().color();
+            QTextEdit textEdit;
+            textEdit.setDocument(&document);
+            textEdit.append(QString("<font color=\"%1\"><b>").arg(color.name())
+                            + nick + "</b>: " + messageText(i) + "</font>");
+        }
+        report(out, "html", messageCount, timer.nsecsElapsed());
+    }
+
+    {
+        QTextDocument document;
+        document.setUndoRedoEnabled(false);
+        QTextCursor cursor(&document);
+        timer.start();
+        for(int i = 0; i < messageCount; i++)
+        {
+            const QString nick = QLatin1String(Nicks[i % NickCount]);
+            const QTextCharFormat &nickFormat = nickFormatCache.format(atomTable.intern(nick));
+            QTextCharFormat messageFormat;
+            messageFormat.setForeground(nickFormat.foreground());
+            cursor.movePosition(QTextCursor::End);
+            if(!document.isEmpty())
+                cursor.insertBlock();
+            cursor.insertText(nick, nickFormat);
+            cursor.insertText(QString(": ") + messageText(i), messageFormat);
+        }
+        report(out, "cursor", messageCount, timer.nsecsElapsed());
+    }
+
+    {
+        QTemporaryDir directory;
+        IRCClient ircClient;
+        IRCChannel *ircChannel = ircClient.ircChannel("#benchmark");
+        ircChannel->setHistoryFileName(directory.path() + "/benchmark.qirclog");
+        IRCChannelDocument *document = IRCChannelDocument::forChannel(ircChannel);
+        document->setScrollbackLimit(messageCount);
+
+        timer.start();
+        for(int i = 0; i < messageCount; i++)
+        {
+            ircChannel->handleMessage(QLatin1String(Nicks[i % NickCount]), messageText(i));
+            if((i + 1) % batchSize == 0 || i + 1 == messageCount)
+                QMetaObject::invokeMethod(ircChannel, "flushMessages");
+        }
+        report(out, "channel", messageCount, timer.nsecsElapsed());
+    }
+    return 0;
+}
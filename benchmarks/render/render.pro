@@ -0,0 +1,21 @@
+QT += network gui widgets
+
+TEMPLATE = app
+
+TARGET = render-benchmark
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../qtirc-core-sources.pri)
+
+HEADERS += \
+    ../../ircchanneldocument.h \
+    ../../ircmessagemodel.h \
+    ../../ircnickformatcache.h
+
+SOURCES += \
+    ../../ircchanneldocument.cpp \
+    ../../ircmessagemodel.cpp \
+    ../../ircnickformatcache.cpp \
+    main.cpp
@@ -0,0 +1,123 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Logs a synthetic channel history, indexes it and times queries over it,
+// verifying candidates by record number as before and by offset as now.
+//
+// Usage: search-benchmark [messages]
+
+// Own includes
+#include "../../ircchannellog.h"
+#include "../../ircsearchindex.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+namespace {
+const char *Words[] = {
+    "hello", "world", "qt", "build", "crash", "patch", "review", "merge",
+    "socket", "thread", "channel", "server", "lag", "timeout", "release",
+    "commit", "branch", "widget", "layout", "signal", "slot", "memory"
+};
+const int WordCount = sizeof(Words) / sizeof(Words[0]);
+}
+
+int
+main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QStringList arguments = application.arguments();
+    const int messageCount = arguments.size() > 1 ? arguments.at(1).toInt() : 1000000;
+    QTextStream out(stdout);
+
+    QTemporaryDir directory;
+    IRCChannelLog channelLog;
+    if(!directory.isValid() || !channelLog.open(directory.path() + "/channel.qirclog"))
+    {
+        out << "Could not create the log.\n";
+        return 1;
+    }
+
+    IRCSearchIndex searchIndex;
+    QVector<qint64> recordNumbers;
+    recordNumbers.reserve(messageCount);
+    quint32 random = 1;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < messageCount; i++)
+    {
+        QString message;
+        for(int word = 0; word < 8; word++)
+        {
+            random = random * 1103515245 + 12345;
+            message += QLatin1String(Words[(random >> 16) % WordCount]);
+            message += QLatin1Char(' ');
+        }
+        message += QString::number(i);
+
+        qint64 offset = channelLog.size();
+        recordNumbers.append(channelLog.recordCount());
+        channelLog.append(i, "nick", "PRIVMSG", message);
+        searchIndex.addMessage(1, 2, offset, message);
+    }
+    channelLog.flush();
+    out << messageCount << " messages logged and indexed in "
+        << timer.elapsed() << " ms\n";
+
+    const char *queries[] = { "crash patch", "lag timeout", "42", "signal slot memory" };
+    for(unsigned int q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+    {
+        const QString text = QLatin1String(queries[q]);
+        for(int byOffset = 0; byOffset < 2; byOffset++)
+        {
+            timer.restart();
+            IRCSearchIndex::Query query(&searchIndex, text, 0, 0);
+            IRCChannelLog::Record record;
+            int candidates = 0;
+            int matches = 0;
+            for(int document = query.next(); document >= 0; document = query.next())
+            {
+                candidates++;
+                if(byOffset)
+                {
+                    if(!channelLog.readAt(searchIndex.document(document).offset, record))
+                        continue;
+                }
+                else
+                {
+                    QVector<IRCChannelLog::Record> records =
+                            channelLog.read(recordNumbers.at(document), 1);
+                    if(records.isEmpty())
+                        continue;
+                    record = records.at(0);
+                }
+                if(record.payload.contains(text, Qt::CaseInsensitive))
+                    matches++;
+            }
+            out << "\"" << text << "\" " << (byOffset ? "by offset" : "by number")
+                << ": " << candidates << " candidates, " << matches << " matches, "
+                << timer.elapsed() << " ms\n";
+        }
+    }
+    return 0;
+}
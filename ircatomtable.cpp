@@ -0,0 +1,260 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircatomtable.h"
+
+namespace {
+const int InitialSlotCount = 64;
+}
+
+IRCAtomTable::IRCAtomTable(CaseMapping caseMapping)
+{
+    m_caseMapping = caseMapping;
+    m_size = 0;
+    // Index 0 is reserved for InvalidAtom.
+    Atom invalid;
+    invalid.hash = 0;
+    invalid.references = 0;
+    invalid.interned = true;
+    m_atoms.append(invalid);
+    m_slots.fill(int(InvalidAtom), InitialSlotCount);
+}
+
+void
+IRCAtomTable::setCaseMapping(CaseMapping caseMapping)
+{
+    if(caseMapping == m_caseMapping)
+        return;
+
+    m_caseMapping = caseMapping;
+    for(int atom = 1; atom < m_atoms.size(); atom++)
+    {
+        Atom &entry = m_atoms[atom];
+        if(entry.interned || entry.references > 0)
+            entry.hash = hash(entry.name);
+    }
+    rehash(m_slots.size());
+}
+
+IRCAtomTable::CaseMapping
+IRCAtomTable::caseMapping() const
+{
+    return m_caseMapping;
+}
+
+IRCAtomTable::CaseMapping
+IRCAtomTable::caseMappingFromName(const QString &name)
+{
+    if(name.compare("ascii", Qt::CaseInsensitive) == 0)
+        return Ascii;
+    if(name.compare("strict-rfc1459", Qt::CaseInsensitive) == 0)
+        return StrictRfc1459;
+    return Rfc1459;
+}
+
+QString
+IRCAtomTable::fold(const QString &name) const
+{
+    QString folded = name;
+    QChar *data = folded.data();
+    for(int i = 0; i < folded.size(); i++)
+        data[i] = QChar(foldChar(data[i].unicode()));
+    return folded;
+}
+
+int
+IRCAtomTable::intern(const QString &name)
+{
+    int atom = acquire(name);
+    m_atoms[atom].interned = true;
+    return atom;
+}
+
+int
+IRCAtomTable::retain(const QString &name)
+{
+    int atom = acquire(name);
+    m_atoms[atom].references++;
+    return atom;
+}
+
+void
+IRCAtomTable::release(int atom)
+{
+    if(atom <= InvalidAtom || atom >= m_atoms.size())
+        return;
+
+    Atom &entry = m_atoms[atom];
+    if(entry.references <= 0 || --entry.references > 0 || entry.interned)
+        return;
+
+    removeSlot(atom);
+    entry.name = QString();
+    m_freeAtoms.append(atom);
+    m_size--;
+}
+
+int
+IRCAtomTable::find(const QString &name) const
+{
+    return m_slots.at(findSlot(name, hash(name)));
+}
+
+QString
+IRCAtomTable::name(int atom) const
+{
+    if(atom > InvalidAtom && atom < m_atoms.size())
+        return m_atoms.at(atom).name;
+    return QString();
+}
+
+int
+IRCAtomTable::size() const
+{
+    return m_size;
+}
+
+ushort
+IRCAtomTable::foldChar(ushort c) const
+{
+    if(c >= 'A' && c <= 'Z')
+        return c + ('a' - 'A');
+    if(m_caseMapping != Ascii && (c == '[' || c == '\\' || c == ']'))
+        return c + ('{' - '[');
+    if(m_caseMapping == Rfc1459 && c == '^')
+        return '~';
+    return c;
+}
+
+uint
+IRCAtomTable::hash(const QString &name) const
+{
+    // FNV-1a over the folded characters.
+    const QChar *data = name.constData();
+    uint hash = 2166136261u;
+    for(int i = 0; i < name.size(); i++)
+        hash = (hash ^ foldChar(data[i].unicode())) * 16777619u;
+    return hash;
+}
+
+int
+IRCAtomTable::findSlot(const QString &name, uint hash) const
+{
+    // Returns the slot holding the id of name, or the empty slot it would
+    // go into.
+    const int mask = m_slots.size() - 1;
+    const QChar *data = name.constData();
+    for(int slot = int(hash & mask);; slot = (slot + 1) & mask)
+    {
+        const int atom = m_slots.at(slot);
+        if(atom == InvalidAtom)
+            return slot;
+
+        const Atom &entry = m_atoms.at(atom);
+        if(entry.hash != hash || entry.name.size() != name.size())
+            continue;
+
+        const QChar *other = entry.name.constData();
+        int i = 0;
+        while(i < name.size() && foldChar(data[i].unicode()) == foldChar(other[i].unicode()))
+            i++;
+        if(i == name.size())
+            return slot;
+    }
+}
+
+int
+IRCAtomTable::acquire(const QString &name)
+{
+    const uint nameHash = hash(name);
+    int slot = findSlot(name, nameHash);
+    if(m_slots.at(slot) != InvalidAtom)
+        return m_slots.at(slot);
+
+    // Keep at least half of the slots empty, so probe sequences stay short.
+    if((m_size + 1) * 2 > m_slots.size())
+    {
+        rehash(m_slots.size() * 2);
+        slot = findSlot(name, nameHash);
+    }
+
+    int atom;
+    if(!m_freeAtoms.isEmpty())
+    {
+        atom = m_freeAtoms.last();
+        m_freeAtoms.removeLast();
+    }
+    else
+    {
+        atom = m_atoms.size();
+        m_atoms.append(Atom());
+    }
+
+    Atom &entry = m_atoms[atom];
+    entry.name = name;
+    entry.hash = nameHash;
+    entry.references = 0;
+    entry.interned = false;
+    m_slots[slot] = atom;
+    m_size++;
+    return atom;
+}
+
+void
+IRCAtomTable::removeSlot(int atom)
+{
+    const int mask = m_slots.size() - 1;
+    int hole = int(m_atoms.at(atom).hash & mask);
+    while(m_slots.at(hole) != atom)
+    {
+        // Names that became equal under a new case mapping have no slot.
+        if(m_slots.at(hole) == InvalidAtom)
+            return;
+        hole = (hole + 1) & mask;
+    }
+
+    // Move later ids of the probe sequence into the hole where they may
+    // go, so lookups never have to skip over removed ids.
+    for(int next = (hole + 1) & mask; m_slots.at(next) != InvalidAtom; next = (next + 1) & mask)
+    {
+        const int home = int(m_atoms.at(m_slots.at(next)).hash & mask);
+        if(((next - home) & mask) >= ((next - hole) & mask))
+        {
+            m_slots[hole] = m_slots.at(next);
+            hole = next;
+        }
+    }
+    m_slots[hole] = InvalidAtom;
+}
+
+void
+IRCAtomTable::rehash(int slotCount)
+{
+    m_slots.fill(int(InvalidAtom), slotCount);
+    for(int atom = 1; atom < m_atoms.size(); atom++)
+    {
+        // Names that become equal under a new case mapping resolve to the id
+        // that was handed out first.
+        const Atom &entry = m_atoms.at(atom);
+        if(!entry.interned && entry.references <= 0)
+            continue;
+        const int slot = findSlot(entry.name, entry.hash);
+        if(m_slots.at(slot) == InvalidAtom)
+            m_slots[slot] = atom;
+    }
+}
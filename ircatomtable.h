@@ -0,0 +1,115 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QString>
+#include <QVector>
+
+/**
+  * \class IRCAtomTable
+  * Maps nick and channel names to small integer ids. Names are folded with
+  * the case mapping of the server first, so all spellings of a name that
+  * the server considers equal share one id. Comparing two names that have
+  * been interned is an integer comparison.
+  *
+  * Names are hashed and compared character by character as they would be
+  * folded, so looking one up does not allocate. Interned names stay for the
+  * lifetime of the table; names that are only held for a while, such as the
+  * nicks in user lists, are reference counted instead and their ids are
+  * handed out again once the last reference has been released.
+  */
+class IRCAtomTable {
+public:
+    enum CaseMapping {
+        /** Only A-Z and a-z are considered equal. */
+        Ascii,
+        /** Additionally []\~ and {}|^ are considered equal. */
+        Rfc1459,
+        /** Like Rfc1459, but ~ and ^ are different. */
+        StrictRfc1459
+    };
+
+    /** The id that stands for no name at all. */
+    static const int InvalidAtom = 0;
+
+    IRCAtomTable(CaseMapping caseMapping = Rfc1459);
+
+    /**
+      * Changes the case mapping. Ids that have been handed out stay valid,
+      * names that become equal under the new mapping resolve to the id that
+      * was handed out first.
+      */
+    void setCaseMapping(CaseMapping caseMapping);
+    CaseMapping caseMapping() const;
+
+    /**
+      * Parses the value of the CASEMAPPING token of RPL_ISUPPORT.
+      * Unknown mappings fall back to Rfc1459.
+      */
+    static CaseMapping caseMappingFromName(const QString& name);
+
+    /** Folds \a name so that equal names compare equal as strings. */
+    QString fold(const QString& name) const;
+
+    /**
+      * Returns the id for \a name, assigning a new one if necessary. The id
+      * stays valid for the lifetime of the table.
+      */
+    int intern(const QString& name);
+
+    /**
+      * Returns the id for \a name, assigning a new one if necessary, and
+      * holds a reference to it. Unless the name is interned as well, the id
+      * is only valid until the reference is released.
+      */
+    int retain(const QString& name);
+
+    /** Releases a reference taken with retain(). */
+    void release(int atom);
+
+    /** Returns the id for \a name, or InvalidAtom if it has none. */
+    int find(const QString& name) const;
+
+    /** Returns the spelling \a atom was first interned with. */
+    QString name(int atom) const;
+
+    /** Number of names that have an id. */
+    int size() const;
+
+private:
+    struct Atom {
+        QString name;
+        uint    hash;
+        int     references;
+        bool    interned;
+    };
+
+    ushort foldChar(ushort c) const;
+    uint hash(const QString& name) const;
+    int findSlot(const QString& name, uint hash) const;
+    int acquire(const QString& name);
+    void removeSlot(int atom);
+    void rehash(int slotCount);
+
+    CaseMapping         m_caseMapping;
+    QVector<Atom>       m_atoms;
+    QVector<int>        m_slots;
+    QVector<int>        m_freeAtoms;
+    int                 m_size;
+};
@@ -0,0 +1,195 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "irccapture.h"
+
+// Qt includes
+#include <QtEndian>
+
+// Standard includes
+#include <string.h>
+
+namespace {
+
+const char CaptureMagic[] = "QIRCCAP1";
+const int HeaderSize = 8;
+const int RecordHeaderSize = 1 + 8 + 4;
+
+}
+
+IRCCapture::IRCCapture()
+{
+    m_clockOffset = 0;
+}
+
+IRCCapture::~IRCCapture()
+{
+    close();
+}
+
+bool
+IRCCapture::open(const QString &fileName)
+{
+    close();
+    m_clockOffset = 0;
+    m_errorString.clear();
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadWrite))
+    {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    if(m_file.size() == 0)
+    {
+        if(m_file.write(CaptureMagic, HeaderSize) != HeaderSize)
+        {
+            m_errorString = m_file.errorString();
+            m_file.close();
+            return false;
+        }
+        m_clock.start();
+        return true;
+    }
+
+    char magic[HeaderSize];
+    if(m_file.read(magic, HeaderSize) != HeaderSize
+       || memcmp(magic, CaptureMagic, HeaderSize) != 0)
+    {
+        m_errorString = QString("%1 is not a capture.").arg(fileName);
+        m_file.close();
+        return false;
+    }
+
+    // Walk the record headers to find where the capture ends and the time
+    // of its last record.
+    qint64 end = HeaderSize;
+    qint64 fileSize = m_file.size();
+    uchar header[RecordHeaderSize];
+    while(m_file.read(reinterpret_cast<char*>(header), RecordHeaderSize) == RecordHeaderSize)
+    {
+        qint64 next = end + RecordHeaderSize + qFromLittleEndian<quint32>(header + 9);
+        if(next > fileSize || !m_file.seek(next))
+            break;
+        m_clockOffset = qFromLittleEndian<qint64>(header + 1);
+        end = next;
+    }
+
+    if((end < fileSize && !m_file.resize(end)) || !m_file.seek(end))
+    {
+        m_errorString = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    m_clock.start();
+    return true;
+}
+
+void
+IRCCapture::close()
+{
+    if(m_file.isOpen())
+        m_file.close();
+}
+
+bool
+IRCCapture::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString
+IRCCapture::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool
+IRCCapture::record(Direction direction, const char *data, qint64 size)
+{
+    if(!m_file.isOpen() || size <= 0)
+        return true;
+
+    uchar header[RecordHeaderSize];
+    header[0] = uchar(direction);
+    qToLittleEndian<qint64>(m_clockOffset + m_clock.nsecsElapsed(), header + 1);
+    qToLittleEndian<quint32>(quint32(size), header + 9);
+
+    // The file buffers, so this does not cost a system call per record.
+    if(m_file.write(reinterpret_cast<const char*>(header), RecordHeaderSize) != RecordHeaderSize
+       || m_file.write(data, size) != size)
+    {
+        m_errorString = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+QString
+IRCCapture::errorString() const
+{
+    return m_errorString;
+}
+
+IRCCaptureReader::IRCCaptureReader()
+{
+}
+
+bool
+IRCCaptureReader::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[HeaderSize];
+    if(m_file.read(magic, HeaderSize) != HeaderSize
+       || memcmp(magic, CaptureMagic, HeaderSize) != 0)
+    {
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+void
+IRCCaptureReader::close()
+{
+    if(m_file.isOpen())
+        m_file.close();
+}
+
+bool
+IRCCaptureReader::readNext(IRCCapture::Record &record)
+{
+    uchar header[RecordHeaderSize];
+    if(!m_file.isOpen()
+       || m_file.read(reinterpret_cast<char*>(header), RecordHeaderSize) != RecordHeaderSize)
+        return false;
+
+    quint32 size = qFromLittleEndian<quint32>(header + 9);
+    if(header[0] > IRCCapture::Outbound || size > quint32(m_file.size()))
+        return false;
+
+    record.direction = IRCCapture::Direction(header[0]);
+    record.timestamp = qFromLittleEndian<qint64>(header + 1);
+    record.data = m_file.read(size);
+    return record.data.size() == int(size);
+}
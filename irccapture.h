@@ -0,0 +1,105 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+#include <QElapsedTimer>
+
+/**
+  * \class IRCCapture
+  * Records the raw bytes exchanged with a server, to reproduce a session
+  * later with IRCReplayDevice.
+  *
+  * A capture file starts with an eight byte magic followed by records.
+  * Every record is the direction as one byte, the time in nanoseconds since
+  * the capture was started as 64 bit value, read from a monotonic clock,
+  * and the 32 bit length of the bytes that follow. Each record holds the
+  * bytes of a single read or write. All integers are little endian.
+  *
+  * Opening an existing capture continues it, so that a capture spans
+  * reconnects. The clock then resumes at the time of the last record.
+  */
+class IRCCapture {
+public:
+    enum Direction {
+        Inbound,
+        Outbound
+    };
+
+    struct Record {
+        Direction  direction;
+        qint64     timestamp;
+        QByteArray data;
+    };
+
+    IRCCapture();
+    ~IRCCapture();
+
+    /**
+      * Continues the capture in \a fileName, or starts a new one if the file
+      * does not exist yet. Fails if the file is not a capture. A record that
+      * was only written partially is dropped.
+      */
+    bool open(const QString& fileName);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+
+    /**
+      * Appends a record. If it cannot be written the capture is closed and
+      * false is returned, errorString() then tells why.
+      */
+    bool record(Direction direction, const char *data, qint64 size);
+
+    QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(IRCCapture)
+
+    QFile         m_file;
+    QElapsedTimer m_clock;
+    qint64        m_clockOffset;
+    QString       m_errorString;
+};
+
+/**
+  * \class IRCCaptureReader
+  * Reads the records of a capture file in order.
+  */
+class IRCCaptureReader {
+public:
+    IRCCaptureReader();
+
+    /** Opens \a fileName, failing if it is not a capture. */
+    bool open(const QString& fileName);
+    void close();
+
+    /**
+      * Reads the next record into \a record. Fails at the end of the capture
+      * and at a record that has only been written partially.
+      */
+    bool readNext(IRCCapture::Record& record);
+
+private:
+    Q_DISABLE_COPY(IRCCaptureReader)
+
+    QFile m_file;
+};
@@ -19,28 +19,39 @@
 #include "ircclient.h"
 #include "ircchannel.h"
 #include "irccommand.h"
+#include "irctrace.h"
 
 // Qt includes
-#include <QPlainTextDocumentLayout>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QUrl>
 
 IRCChannel::IRCChannel(IRCClient *ircClient,
                                          QString channelName,
                                          QObject *parent) :
     QObject(parent),
+    m_userListModel(ircClient->atomTable()),
     m_ircClient(ircClient)
 {
     m_channelName = channelName;
+    m_channelAtom = ircClient->atomTable()->intern(channelName);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FrameInterval);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flushMessages()));
+
+    m_indexTimer.setInterval(0);
+    connect(&m_indexTimer, SIGNAL(timeout()), this, SLOT(indexHistory()));
+
     connect(ircClient, SIGNAL(nicknameChanged(QString, QString)),
              this, SLOT(handleNickChange(QString, QString)));
+    connect(ircClient, SIGNAL(userQuit(QString, QString)),
+             this, SLOT(handleQuit(QString)));
 }
 
-QTextDocument *
-IRCChannel::conversationModel ()
-{
-    return &m_conversationModel;
-}
-
-QStringListModel *
+IRCUserListModel *
 IRCChannel::userListModel ()
 {
     return &m_userListModel;
@@ -52,21 +63,71 @@ IRCChannel::channelName ()
     return m_channelName;
 }
 
+IRCClient *
+IRCChannel::ircClient ()
+{
+    return m_ircClient;
+}
+
+int
+IRCChannel::channelAtom ()
+{
+    return m_channelAtom;
+}
+
+void
+IRCChannel::setHistoryFileName(const QString &fileName)
+{
+    m_channelLog.close();
+    m_indexTimer.stop();
+    m_ircClient->searchIndex()->removeChannel(m_channelAtom);
+    m_historyFileName = fileName;
+}
+
+QString
+IRCChannel::historyFileName()
+{
+    if(m_historyFileName.isEmpty())
+    {
+        QString server = QString::fromLatin1(QUrl::toPercentEncoding(m_ircClient->hostName()));
+        QString channel = QString::fromLatin1(QUrl::toPercentEncoding(
+                    m_ircClient->atomTable()->fold(m_channelName)));
+        m_historyFileName =
+                QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+                + "/logs/" + server + "/" + channel + ".qirclog";
+    }
+    return m_historyFileName;
+}
+
+IRCChannelLog *
+IRCChannel::channelLog()
+{
+    openChannelLog();
+    return &m_channelLog;
+}
+
 void
 IRCChannel::nameReply(const QStringList &nickList)
 {
-    m_userList.append(nickList);
+    // Names arrive in many chunks. They are collected until the end of the
+    // list, which is then published at once.
+    m_pendingNames.append(nickList);
+}
+
+void
+IRCChannel::endOfNames()
+{
     processUserList();
 }
 
 void
 IRCChannel::sendMessage(const QString& message)
 {
-    QStringList arguments;
-    arguments << m_channelName;
-    arguments << message;
-    m_ircClient->sendIRCCommand(IRCCommand::PrivateMessage, arguments);
-    handleMessage(m_ircClient->nickname(), message);
+    m_ircClient->sendPrivateMessage(m_channelName, message);
+
+    // Show every line that went out as a message of its own.
+    foreach(const QString &line, message.split(QLatin1Char('\n'), QString::SkipEmptyParts))
+        handleMessage(m_ircClient->nickname(), line);
 }
 
 void
@@ -83,53 +144,142 @@ IRCChannel::leave (const QString& reason)
 
 void IRCChannel::handleMessage(const QString &nick, const QString &message)
 {
-    int i, colorTablePosition = 0;
-    for(i = 0; i < m_userList.size(); i++) {
-        if(m_userList.at(i) == nick) {
-            colorTablePosition = i;
-            break;
+    IRC_TRACE_SCOPE("IRCChannel::handleMessage");
+    // Messages are announced once per frame, so a burst of them costs a
+    // single layout and scroll instead of one per message.
+    IRCChannelMessage pendingMessage;
+    pendingMessage.timestamp = QDateTime::currentMSecsSinceEpoch();
+    pendingMessage.nickAtom = m_ircClient->atomTable()->intern(nick);
+    pendingMessage.nick = nick;
+    pendingMessage.message = message;
+    pendingMessage.record = -1;
+    // Every message is a single line.
+    pendingMessage.message.replace(QLatin1Char('\r'), QLatin1Char(' '))
+            .replace(QLatin1Char('\n'), QLatin1Char(' '))
+            .replace(QChar::ParagraphSeparator, QLatin1Char(' '));
+    m_pendingMessages.append(pendingMessage);
+
+    if(!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void
+IRCChannel::flushMessages()
+{
+    IRC_TRACE_SCOPE("IRCChannel::flushMessages");
+    if(m_pendingMessages.isEmpty())
+        return;
+
+    if(openChannelLog())
+    {
+        // Messages are indexed right away, unless older records are still
+        // waiting for the background indexer, which then takes them in
+        // order.
+        IRCSearchIndex *searchIndex = m_ircClient->searchIndex();
+        const bool indexNow = indexedRecords() == m_channelLog.recordCount();
+        for(int i = 0; i < m_pendingMessages.size(); i++)
+        {
+            IRCChannelMessage &message = m_pendingMessages[i];
+            qint64 record = m_channelLog.recordCount();
+            qint64 offset = m_channelLog.size();
+            if(!m_channelLog.append(message.timestamp, message.nick,
+                                    IRCCommand::PrivateMessage, message.message))
+                continue;
+
+            message.record = record;
+            if(indexNow)
+                searchIndex->addMessage(m_channelAtom, message.nickAtom,
+                                        offset, message.message);
         }
+        m_channelLog.flush();
+
+        if(indexNow)
+            searchIndex->setIndexedRecords(m_channelAtom, m_channelLog.recordCount());
+        else if(!m_indexTimer.isActive())
+            m_indexTimer.start();
+    }
+
+    emit messagesReceived(m_pendingMessages);
+    m_pendingMessages.resize(0);
+}
+
+bool
+IRCChannel::openChannelLog()
+{
+    if(m_channelLog.isOpen())
+        return true;
+
+    QString fileName = historyFileName();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    if(!m_channelLog.open(fileName))
+        return false;
+
+    // Make what earlier sessions logged since the index was saved
+    // searchable in the background.
+    if(indexedRecords() < m_channelLog.recordCount())
+        m_indexTimer.start();
+    return true;
+}
+
+qint64
+IRCChannel::indexedRecords()
+{
+    IRCSearchIndex *searchIndex = m_ircClient->searchIndex();
+    qint64 records = searchIndex->claimChannel(m_channelAtom, m_channelLog.fileName());
+    if(records > m_channelLog.recordCount())
+    {
+        // The log has been replaced by a shorter one since.
+        searchIndex->removeChannel(m_channelAtom);
+        records = searchIndex->claimChannel(m_channelAtom, m_channelLog.fileName());
     }
+    return records;
+}
+
+void
+IRCChannel::indexHistory()
+{
+    const qint64 first = indexedRecords();
+    int count = int(qMin<qint64>(IndexBatchSize, m_channelLog.recordCount() - first));
+    QVector<IRCChannelLog::Record> records = m_channelLog.read(first, count);
 
-    QColor color = m_colorTable.at(colorTablePosition);
+    IRCAtomTable *atomTable = m_ircClient->atomTable();
+    IRCSearchIndex *searchIndex = m_ircClient->searchIndex();
+    for(int i = 0; i < records.size(); i++)
+    {
+        const IRCChannelLog::Record &record = records.at(i);
+        if(record.command == IRCCommand::PrivateMessage)
+            searchIndex->addMessage(m_channelAtom, atomTable->intern(record.sender),
+                                    record.offset, record.payload);
+    }
 
-    QTextEdit textEdit;
-    textEdit.setDocument(&m_conversationModel);
-    textEdit.append(QString("<font color=\"%1\"><b>").arg(color.name()) + nick + "</b>: " + message + "</font>");
+    searchIndex->setIndexedRecords(m_channelAtom, first + records.size());
+    if(records.isEmpty() || first + records.size() >= m_channelLog.recordCount())
+        m_indexTimer.stop();
 }
 
 void
 IRCChannel::handleNickChange (const QString &oldNick, const QString &newNick)
 {
-    m_userList = m_userListModel.stringList ();
-    m_userList.removeAll (oldNick);
-    processUserList();
+    m_userListModel.renameUser(m_ircClient->atomTable()->find(oldNick), newNick);
 }
 
 void
 IRCChannel::handleJoin (const QString &nick)
 {
-    m_userList = m_userListModel.stringList ();
-    m_userList.append (nick);
-    processUserList();
+    m_userListModel.addUser(nick);
 }
 
 void
-IRCChannel::processUserList()
+IRCChannel::handleQuit (const QString &nick)
 {
-    m_userList.removeDuplicates();
-    m_userList.sort();
-    m_userListModel.setStringList (m_userList);
-    rebuildColorTable();
+    m_userListModel.removeUser(m_ircClient->atomTable()->find(nick));
 }
 
 void
-IRCChannel::rebuildColorTable()
+IRCChannel::processUserList()
 {
-    int i, size = m_userList.size();
-    m_colorTable.clear();
-    m_colorTable.resize(size);
-    for(i = 0; i < size; i++) {
-        m_colorTable[i] = QColor::fromHsv((double)i * 360.0 / (double)size, 255, 128);
-    }
+    IRC_TRACE_SCOPE("IRCChannel::processUserList");
+    // A complete names list replaces whatever we knew before.
+    m_userListModel.setUsers(m_pendingNames);
+    m_pendingNames.clear();
 }
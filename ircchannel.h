@@ -18,19 +18,41 @@
 #pragma once
 
 // Own includes
+#include "ircuserlistmodel.h"
+#include "ircchannellog.h"
 class IRCClient;
 
 // Qt includes
 #include <QObject>
 #include <QVector>
-#include <QColor>
-#include <QTextDocument>
-#include <QStringListModel>
+#include <QTimer>
+
+/** A message that has been sent to a channel. */
+struct IRCChannelMessage {
+    /** Milliseconds since the epoch the message arrived at. */
+    qint64  timestamp;
+    int     nickAtom;
+    QString nick;
+    /** The text of the message, always a single line. */
+    QString message;
+    /**
+      * Number of the record the message has in the log of the channel, or
+      * -1 if it could not be logged.
+      */
+    qint64  record;
+};
+
+/** Messages that arrived at a channel within one frame. */
+typedef QVector<IRCChannelMessage> IRCChannelMessageBatch;
 
 /**
   * \class IRCChannel
   * Implements a handle to an IRC channel. This is usually provided by the
   * the IRC client class.
+  *
+  * The channel keeps the state of the conversation, but does not present
+  * it. Messages are logged, indexed for search and then announced in
+  * batches; presentations such as IRCChannelDocument build on that.
   */
 class IRCChannel :
         public QObject {
@@ -39,12 +61,49 @@ public:
     IRCChannel(IRCClient *ircClient,
                         QString channelName,
                         QObject *parent = 0);
-    QTextDocument *conversationModel();
-    QStringListModel *userListModel();
+    IRCUserListModel *userListModel();
     QString channelName();
 
+    /** The client this channel has been joined with. */
+    IRCClient *ircClient();
+
+    /** The id of this channel's name in the atom table of the client. */
+    int channelAtom();
+
+    /**
+      * Milliseconds incoming messages are collected for before they are
+      * announced together, about one frame of a 60 Hz display.
+      */
+    static const int FrameInterval = 16;
+
+    /**
+      * Number of records of earlier sessions added to the search index at a
+      * time, while the application is idle.
+      */
+    static const int IndexBatchSize = 4096;
+
+    /**
+      * Sets the file every message of the channel is logged to. By default
+      * this is a file per server and channel in the data location of the
+      * application. A new file only receives messages arriving afterwards,
+      * and the messages of the previous file can no longer be searched.
+      */
+    void setHistoryFileName(const QString& fileName);
+    QString historyFileName();
+
+    /** The log of this channel, opened on first use. */
+    IRCChannelLog *channelLog();
+
+signals:
+    /**
+      * Sent after a batch of messages has been logged.
+      * \arg messages The messages, oldest first.
+      */
+    void messagesReceived(const IRCChannelMessageBatch& messages);
+
 public slots:
     void nameReply(const QStringList &nickList);
+    void endOfNames();
     void sendMessage(const QString& message);
     void sendJoinRequest();
     void leave(const QString &reason);
@@ -52,15 +111,25 @@ public slots:
     void handleMessage(const QString &nick, const QString &message);
     void handleNickChange(const QString& oldNick, const QString& newNick);
     void handleJoin(const QString& nick);
+    void handleQuit(const QString& nick);
+
+private slots:
+    void flushMessages();
+    void indexHistory();
 
 private:
     void processUserList();
-    void rebuildColorTable();
+    bool openChannelLog();
+    qint64 indexedRecords();
 
     QString             m_channelName;
-    QStringList         m_userList;
-    QStringListModel    m_userListModel;
-    QTextDocument       m_conversationModel;
+    int                 m_channelAtom;
+    IRCUserListModel    m_userListModel;
+    QStringList         m_pendingNames;
+    IRCChannelMessageBatch m_pendingMessages;
+    QTimer              m_flushTimer;
+    IRCChannelLog       m_channelLog;
+    QString             m_historyFileName;
+    QTimer              m_indexTimer;
     IRCClient      *m_ircClient;
-    QVector<QColor>     m_colorTable;
 };
@@ -0,0 +1,336 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircchanneldocument.h"
+#include "ircclient.h"
+#include "irctrace.h"
+
+// Qt includes
+#include <QTextBlock>
+
+namespace {
+
+/** Remembers which record of the channel log a line of the conversation shows. */
+class RecordData :
+        public QTextBlockUserData {
+public:
+    RecordData(qint64 record) : record(record) {}
+
+    const qint64 record;
+};
+
+qint64
+recordOf(const QTextBlock &block)
+{
+    RecordData *data = static_cast<RecordData*>(block.userData());
+    return data ? data->record : -1;
+}
+
+}
+
+IRCChannelDocument *
+IRCChannelDocument::forChannel(IRCChannel *ircChannel)
+{
+    IRCChannelDocument *document =
+            ircChannel->findChild<IRCChannelDocument*>(QString(), Qt::FindDirectChildrenOnly);
+    if(!document)
+    {
+        IRCClient *ircClient = ircChannel->ircClient();
+        document = new IRCChannelDocument(ircChannel,
+                                          IRCNickFormatCache::forClient(ircClient),
+                                          ircChannel);
+    }
+    return document;
+}
+
+IRCChannelDocument::IRCChannelDocument(IRCChannel *ircChannel,
+                                       IRCNickFormatCache *nickFormatCache,
+                                       QObject *parent) :
+    QObject(parent)
+{
+    m_ircChannel = ircChannel;
+    m_nickFormatCache = nickFormatCache;
+
+    // Nobody edits the conversation, so there is no need to record every
+    // insertion for undo.
+    m_conversationModel.setUndoRedoEnabled(false);
+    m_conversationCursor = QTextCursor(&m_conversationModel);
+
+    m_messageModel = 0;
+    m_scrollbackLimit = DefaultScrollbackLimit;
+    m_pagedInLines = 0;
+    m_keepPagedInLines = false;
+    m_pagedInMessages = 0;
+    m_renderTimer.start();
+
+    // Everything logged so far is older history.
+    m_firstRecord = ircChannel->channelLog()->recordCount();
+    m_firstMessageRecord = m_firstRecord;
+
+    connect(ircChannel, SIGNAL(messagesReceived(IRCChannelMessageBatch)),
+            this, SLOT(handleMessages(IRCChannelMessageBatch)));
+}
+
+IRCChannel *
+IRCChannelDocument::ircChannel()
+{
+    return m_ircChannel;
+}
+
+QTextDocument *
+IRCChannelDocument::conversationModel()
+{
+    return &m_conversationModel;
+}
+
+IRCMessageModel *
+IRCChannelDocument::messageModel()
+{
+    if(!m_messageModel)
+    {
+        IRCAtomTable *atomTable = m_ircChannel->ircClient()->atomTable();
+        m_messageModel = new IRCMessageModel(atomTable, m_nickFormatCache, this);
+
+        // The logged lines of the conversation are read back from the log,
+        // which has the time they arrived at as well.
+        IRCChannelLog *channelLog = m_ircChannel->channelLog();
+        QVector<IRCChannelLog::Record> records =
+                channelLog->read(m_firstRecord, int(channelLog->recordCount() - m_firstRecord));
+        for(int i = 0; i < records.size(); i++)
+        {
+            const IRCChannelLog::Record &record = records.at(i);
+            m_messageModel->appendMessage(record.timestamp, atomTable->intern(record.sender),
+                                          record.payload, m_firstRecord + i);
+        }
+        m_messageModel->publish();
+        m_firstMessageRecord = m_firstRecord;
+        m_pagedInMessages = m_pagedInLines;
+    }
+    return m_messageModel;
+}
+
+void
+IRCChannelDocument::setScrollbackLimit(int lines)
+{
+    m_scrollbackLimit = qMax(1, lines);
+    trimScrollback();
+}
+
+int
+IRCChannelDocument::scrollbackLimit()
+{
+    return m_scrollbackLimit;
+}
+
+bool
+IRCChannelDocument::hasOlderHistory()
+{
+    return m_firstRecord > 0 && m_ircChannel->channelLog()->isOpen();
+}
+
+bool
+IRCChannelDocument::hasOlderMessages()
+{
+    return m_messageModel && m_firstMessageRecord > 0
+        && m_ircChannel->channelLog()->isOpen();
+}
+
+void
+IRCChannelDocument::handleMessages(const IRCChannelMessageBatch &messages)
+{
+    IRC_TRACE_SCOPE("IRCChannelDocument::handleMessages");
+    qint64 renderStart = m_renderTimer.nsecsElapsed();
+    m_conversationCursor.beginEditBlock();
+    for(int i = 0; i < messages.size(); i++)
+        renderMessage(messages.at(i));
+    m_conversationCursor.endEditBlock();
+
+    if(m_messageModel)
+    {
+        for(int i = 0; i < messages.size(); i++)
+        {
+            const IRCChannelMessage &message = messages.at(i);
+            m_messageModel->appendMessage(message.timestamp, message.nickAtom,
+                                          message.message, message.record);
+        }
+        m_messageModel->publish();
+    }
+
+    trimScrollback();
+    m_ircChannel->ircClient()->metrics()->recordRenderTime(
+                m_ircChannel->channelName(), m_renderTimer.nsecsElapsed() - renderStart);
+    emit conversationUpdated();
+}
+
+void
+IRCChannelDocument::renderMessage(const IRCChannelMessage &message)
+{
+    const QTextCharFormat &nickFormat = m_nickFormatCache->format(message.nickAtom);
+    QTextCharFormat messageFormat;
+    messageFormat.setForeground(nickFormat.foreground());
+
+    // Insert the pieces with their formats directly, which neither needs a
+    // widget nor goes through the HTML parser. As a side effect, markup in
+    // messages is no longer interpreted.
+    m_conversationCursor.movePosition(QTextCursor::End);
+    if(!m_conversationModel.isEmpty())
+        m_conversationCursor.insertBlock();
+    m_conversationCursor.insertText(message.nick, nickFormat);
+    m_conversationCursor.insertText(QString(": ") + message.message, messageFormat);
+    m_conversationCursor.block().setUserData(new RecordData(message.record));
+}
+
+void
+IRCChannelDocument::trimScrollback()
+{
+    int limit = m_scrollbackLimit;
+    if(m_keepPagedInLines)
+        limit += m_pagedInLines;
+
+    int excess = m_conversationModel.blockCount() - limit;
+    if(excess > 0 && !m_conversationModel.isEmpty())
+        evictBlocks(excess);
+
+    // The message model pages in history on its own, so it is bounded on
+    // its own as well.
+    if(m_messageModel)
+    {
+        int messageLimit = m_scrollbackLimit;
+        if(m_keepPagedInLines)
+            messageLimit += m_pagedInMessages;
+
+        int excessMessages = m_messageModel->messageCount() - messageLimit;
+        if(excessMessages > 0)
+            removeMessages(excessMessages);
+    }
+}
+
+void
+IRCChannelDocument::evictBlocks(int count)
+{
+    // The conversation starts after the last logged line that is evicted.
+    // Lines that could not be logged have no record to page in again and
+    // do not count. Paged in lines are always the topmost ones and are
+    // evicted first.
+    QTextBlock block = m_conversationModel.begin();
+    for(int i = 0; i < count && block.isValid(); i++, block = block.next())
+    {
+        qint64 record = recordOf(block);
+        if(record >= 0)
+            m_firstRecord = record + 1;
+    }
+    m_pagedInLines -= qMin(count, m_pagedInLines);
+
+    QTextCursor cursor(&m_conversationModel);
+    cursor.movePosition(QTextCursor::Start);
+    cursor.movePosition(QTextCursor::NextBlock, QTextCursor::KeepAnchor, count);
+    if(cursor.atEnd() || count >= m_conversationModel.blockCount())
+        cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+}
+
+void
+IRCChannelDocument::removeMessages(int count)
+{
+    // Works like evictBlocks() for the rows of the message model.
+    for(int row = count - 1; row >= 0; row--)
+    {
+        qint64 record = m_messageModel->record(row);
+        if(record >= 0)
+        {
+            m_firstMessageRecord = record + 1;
+            break;
+        }
+    }
+    m_pagedInMessages -= qMin(count, m_pagedInMessages);
+    m_messageModel->removeFirstMessages(count);
+}
+
+int
+IRCChannelDocument::loadOlderHistory(int lines)
+{
+    if(lines <= 0 || !hasOlderHistory())
+        return 0;
+
+    QVector<IRCChannelLog::Record> records =
+            m_ircChannel->channelLog()->read(qMax<qint64>(0, m_firstRecord - lines),
+                                             int(qMin<qint64>(lines, m_firstRecord)));
+    if(records.isEmpty())
+        return 0;
+
+    qint64 firstRecord = m_firstRecord - records.size();
+    m_firstRecord = firstRecord;
+    m_pagedInLines += records.size();
+    m_keepPagedInLines = true;
+
+    // Insert the lines in front of the conversation, oldest first.
+    IRCAtomTable *atomTable = m_ircChannel->ircClient()->atomTable();
+    bool empty = m_conversationModel.isEmpty();
+    qint64 firstBlockRecord = recordOf(m_conversationModel.begin());
+
+    QTextCursor cursor(&m_conversationModel);
+    cursor.beginEditBlock();
+    for(int i = 0; i < records.size(); i++)
+    {
+        const IRCChannelLog::Record &record = records.at(i);
+        const QTextCharFormat &nickFormat =
+                m_nickFormatCache->format(atomTable->intern(record.sender));
+        QTextCharFormat messageFormat;
+        messageFormat.setForeground(nickFormat.foreground());
+
+        cursor.insertText(record.sender, nickFormat);
+        cursor.insertText(QString(": ") + record.payload, messageFormat);
+        cursor.block().setUserData(new RecordData(firstRecord + i));
+        if(!empty || i < records.size() - 1)
+        {
+            cursor.insertBlock();
+            cursor.block().previous().setUserData(new RecordData(firstRecord + i));
+        }
+    }
+    if(!empty)
+        cursor.block().setUserData(new RecordData(firstBlockRecord));
+    cursor.endEditBlock();
+
+    return records.size();
+}
+
+int
+IRCChannelDocument::loadOlderMessages(int lines)
+{
+    if(lines <= 0 || !hasOlderMessages())
+        return 0;
+
+    qint64 first = qMax<qint64>(0, m_firstMessageRecord - lines);
+    QVector<IRCChannelLog::Record> records =
+            m_ircChannel->channelLog()->read(first, int(m_firstMessageRecord - first));
+    if(records.isEmpty())
+        return 0;
+
+    m_messageModel->prependRecords(first, records);
+    m_firstMessageRecord = first;
+    m_pagedInMessages += records.size();
+    m_keepPagedInLines = true;
+    return records.size();
+}
+
+void
+IRCChannelDocument::releasePagedHistory()
+{
+    m_keepPagedInLines = false;
+    trimScrollback();
+}
@@ -0,0 +1,125 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircchannel.h"
+#include "ircmessagemodel.h"
+#include "ircnickformatcache.h"
+
+// Qt includes
+#include <QObject>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QElapsedTimer>
+
+/**
+  * \class IRCChannelDocument
+  * Presents the conversation of a channel as a rich text document, and
+  * optionally as a compact message model. The document holds a limited
+  * number of lines; older lines can be paged in again from the log of the
+  * channel.
+  */
+class IRCChannelDocument :
+        public QObject {
+    Q_OBJECT
+public:
+    /**
+      * Returns the document of \a ircChannel, creating it on first use. It
+      * is owned by the channel and only holds lines that arrive afterwards.
+      */
+    static IRCChannelDocument *forChannel(IRCChannel *ircChannel);
+
+    IRCChannelDocument(IRCChannel *ircChannel,
+                       IRCNickFormatCache *nickFormatCache,
+                       QObject *parent = 0);
+
+    IRCChannel *ircChannel();
+    QTextDocument *conversationModel();
+
+    /**
+      * Compact model of the conversation for views that only lay out what
+      * is visible. It is created on first use, filled from the log with the
+      * logged lines the conversation holds at that time, and kept up to date
+      * from then on.
+      */
+    IRCMessageModel *messageModel();
+
+    /** Number of lines kept in memory unless configured otherwise. */
+    static const int DefaultScrollbackLimit = 10000;
+
+    /**
+      * Limits the number of lines kept in the conversation. Older lines
+      * remain in the log of the channel and can be paged in again.
+      */
+    void setScrollbackLimit(int lines);
+    int scrollbackLimit();
+
+    /** Whether there are logged lines older than the conversation. */
+    bool hasOlderHistory();
+
+    /** Whether there are logged lines older than the message model. */
+    bool hasOlderMessages();
+
+signals:
+    /** Sent after a batch of messages has been added to the conversation. */
+    void conversationUpdated();
+
+public slots:
+    /**
+      * Pages up to \a lines lines from the log back into the top of
+      * the conversation. They are kept until releasePagedHistory() is called.
+      * \return The number of lines that have been loaded.
+      */
+    int loadOlderHistory(int lines);
+
+    /**
+      * Pages up to \a lines lines from the log back into the top of the
+      * message model, which keeps them like loadOlderHistory() does.
+      * \return The number of lines that have been loaded.
+      */
+    int loadOlderMessages(int lines);
+
+    /**
+      * Lets the scrollback limit apply to lines that have been paged in
+      * again, both in the conversation and in the message model.
+      */
+    void releasePagedHistory();
+
+private slots:
+    void handleMessages(const IRCChannelMessageBatch& messages);
+
+private:
+    void renderMessage(const IRCChannelMessage& message);
+    void trimScrollback();
+    void evictBlocks(int count);
+    void removeMessages(int count);
+
+    IRCChannel *        m_ircChannel;
+    IRCNickFormatCache *m_nickFormatCache;
+    QTextDocument       m_conversationModel;
+    QTextCursor         m_conversationCursor;
+    IRCMessageModel    *m_messageModel;
+    int                 m_scrollbackLimit;
+    qint64              m_firstRecord;
+    int                 m_pagedInLines;
+    bool                m_keepPagedInLines;
+    qint64              m_firstMessageRecord;
+    int                 m_pagedInMessages;
+    QElapsedTimer       m_renderTimer;
+};
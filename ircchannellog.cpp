@@ -0,0 +1,423 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircchannellog.h"
+
+// Qt includes
+#include <QtEndian>
+
+// Standard includes
+#include <string.h>
+
+namespace {
+const char LogMagic[] = "QIRCLOG1";
+const qint64 HeaderSize = 8;
+const int IndexEntrySize = 16;
+// Length, timestamp and the lengths of sender and command.
+const int RecordHeaderSize = 4 + 8 + 2 + 2;
+// Records appended since the log was mapped are kept in memory up to this
+// size, so reading while messages arrive does not map the file every time.
+const int MaximumTailSize = 4 * 1024 * 1024;
+}
+
+IRCChannelLog::IRCChannelLog()
+    : m_recordCount(0),
+      m_size(0),
+      m_map(0),
+      m_mapSize(0)
+{
+}
+
+IRCChannelLog::~IRCChannelLog()
+{
+    close();
+}
+
+bool
+IRCChannelLog::open(const QString& fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    m_indexFile.setFileName(fileName + ".idx");
+    if(!m_file.open(QIODevice::ReadWrite)
+    || !m_indexFile.open(QIODevice::ReadWrite))
+    {
+        close();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if(m_size < HeaderSize)
+    {
+        // New or unusable log, start over.
+        m_file.resize(0);
+        m_indexFile.resize(0);
+        m_file.write(LogMagic, HeaderSize);
+        m_file.flush();
+        m_size = HeaderSize;
+    }
+    else
+    {
+        char magic[HeaderSize];
+        if(m_file.read(magic, HeaderSize) != HeaderSize
+        || memcmp(magic, LogMagic, HeaderSize) != 0)
+        {
+            close();
+            return false;
+        }
+    }
+
+    // Load the index, dropping entries that point beyond the log.
+    QByteArray index = m_indexFile.readAll();
+    const int entryCount = index.size() / IndexEntrySize;
+    const uchar *entry = reinterpret_cast<const uchar*>(index.constData());
+    for(int i = 0; i < entryCount; i++, entry += IndexEntrySize)
+    {
+        IndexEntry indexEntry;
+        indexEntry.timestamp = qFromLittleEndian<qint64>(entry);
+        indexEntry.offset = qFromLittleEndian<qint64>(entry + 8);
+        if(indexEntry.offset < HeaderSize || indexEntry.offset >= m_size)
+            break;
+        m_index.append(indexEntry);
+    }
+
+    if(!map())
+    {
+        close();
+        return false;
+    }
+
+    // Count the records after the last indexed one, index what is missing
+    // and cut off a partially written record at the end.
+    qint64 offset = HeaderSize;
+    m_recordCount = 0;
+    if(!m_index.isEmpty())
+    {
+        offset = m_index.last().offset;
+        m_recordCount = qint64(m_index.size() - 1) * IndexInterval;
+        if(recordEnd(offset) < 0)
+        {
+            m_index.clear();
+            offset = HeaderSize;
+            m_recordCount = 0;
+        }
+    }
+    m_indexFile.resize(qint64(m_index.size()) * IndexEntrySize);
+
+    while(offset < m_size)
+    {
+        qint64 end = recordEnd(offset);
+        if(end < 0)
+        {
+            m_file.unmap(m_map);
+            m_map = 0;
+            m_mapSize = 0;
+            m_file.resize(offset);
+            m_size = offset;
+            map();
+            break;
+        }
+        if(m_recordCount == qint64(m_index.size()) * IndexInterval)
+            addIndexEntry(recordTimestamp(offset), offset);
+        m_recordCount++;
+        offset = end;
+    }
+    m_indexFile.flush();
+    return true;
+}
+
+void
+IRCChannelLog::close()
+{
+    if(m_map)
+    {
+        m_file.unmap(m_map);
+        m_map = 0;
+        m_mapSize = 0;
+    }
+    m_tail.clear();
+    m_file.close();
+    m_indexFile.close();
+    m_index.clear();
+    m_recordCount = 0;
+    m_size = 0;
+}
+
+bool
+IRCChannelLog::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString
+IRCChannelLog::fileName() const
+{
+    return m_file.fileName();
+}
+
+qint64
+IRCChannelLog::recordCount() const
+{
+    return m_recordCount;
+}
+
+qint64
+IRCChannelLog::size() const
+{
+    return m_size;
+}
+
+bool
+IRCChannelLog::append(qint64 timestamp, const QString& sender,
+                      const QString& command, const QString& payload)
+{
+    if(!isOpen())
+        return false;
+
+    QByteArray senderBytes = sender.toUtf8().left(0xffff);
+    QByteArray commandBytes = command.toUtf8().left(0xffff);
+    QByteArray payloadBytes = payload.toUtf8();
+    const int length = RecordHeaderSize - 4 + senderBytes.size()
+                     + commandBytes.size() + payloadBytes.size();
+
+    QByteArray record;
+    record.resize(4 + length);
+    uchar *out = reinterpret_cast<uchar*>(record.data());
+    qToLittleEndian<quint32>(length, out);
+    qToLittleEndian<qint64>(timestamp, out + 4);
+    qToLittleEndian<quint16>(senderBytes.size(), out + 12);
+    out += 14;
+    memcpy(out, senderBytes.constData(), senderBytes.size());
+    out += senderBytes.size();
+    qToLittleEndian<quint16>(commandBytes.size(), out);
+    out += 2;
+    memcpy(out, commandBytes.constData(), commandBytes.size());
+    out += commandBytes.size();
+    memcpy(out, payloadBytes.constData(), payloadBytes.size());
+
+    if(!m_file.seek(m_size) || m_file.write(record) != record.size())
+        return false;
+
+    // Readers see the record through the tail until the log is mapped
+    // again, which happens lazily once the tail grows too large.
+    if(m_map)
+    {
+        m_tail.append(record);
+        if(m_tail.size() > MaximumTailSize)
+        {
+            m_file.unmap(m_map);
+            m_map = 0;
+            m_mapSize = 0;
+            m_tail.clear();
+        }
+    }
+
+    if(m_recordCount % IndexInterval == 0)
+        addIndexEntry(timestamp, m_size);
+    m_size += record.size();
+    m_recordCount++;
+    return true;
+}
+
+void
+IRCChannelLog::flush()
+{
+    m_file.flush();
+    m_indexFile.flush();
+}
+
+QVector<IRCChannelLog::Record>
+IRCChannelLog::read(qint64 first, int count)
+{
+    QVector<Record> records;
+    if(first < 0)
+    {
+        count += first;
+        first = 0;
+    }
+    count = qMin<qint64>(count, m_recordCount - first);
+    if(count <= 0 || !map())
+        return records;
+
+    records.reserve(count);
+    qint64 offset = offsetOf(first);
+    while(records.size() < count && offset >= 0 && offset < m_size)
+    {
+        const qint64 end = recordEnd(offset);
+        if(end < 0)
+            break;
+
+        Record record;
+        decode(offset, end, record);
+        records.append(record);
+        offset = end;
+    }
+    return records;
+}
+
+bool
+IRCChannelLog::readAt(qint64 offset, Record &record)
+{
+    if(offset < HeaderSize || offset >= m_size || !map())
+        return false;
+
+    const qint64 end = recordEnd(offset);
+    if(end < 0)
+        return false;
+    decode(offset, end, record);
+    return true;
+}
+
+qint64
+IRCChannelLog::indexOfTime(qint64 timestamp)
+{
+    if(m_index.isEmpty() || !map())
+        return m_recordCount;
+
+    // Find the last index entry not later than the timestamp.
+    int low = 0;
+    int high = m_index.size();
+    while(low < high)
+    {
+        int middle = (low + high) / 2;
+        if(m_index.at(middle).timestamp <= timestamp)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if(low == 0)
+        return 0;
+
+    qint64 record = qint64(low - 1) * IndexInterval;
+    qint64 offset = m_index.at(low - 1).offset;
+    while(record < m_recordCount && recordTimestamp(offset) < timestamp)
+    {
+        offset = recordEnd(offset);
+        if(offset < 0)
+            return m_recordCount;
+        record++;
+    }
+    return record;
+}
+
+bool
+IRCChannelLog::map()
+{
+    if(m_map)
+        return true;
+
+    m_file.flush();
+    if(m_map)
+    {
+        m_file.unmap(m_map);
+        m_map = 0;
+        m_mapSize = 0;
+    }
+    m_map = m_file.map(0, m_size);
+    if(!m_map)
+        return false;
+    m_mapSize = m_size;
+    m_tail.clear();
+    return true;
+}
+
+const uchar *
+IRCChannelLog::at(qint64 offset) const
+{
+    // Records never straddle the end of the mapping.
+    if(offset < m_mapSize)
+        return m_map + offset;
+    return reinterpret_cast<const uchar*>(m_tail.constData()) + (offset - m_mapSize);
+}
+
+qint64
+IRCChannelLog::offsetOf(qint64 record)
+{
+    const int entry = int(record / IndexInterval);
+    if(record < 0 || entry >= m_index.size())
+        return -1;
+
+    qint64 offset = m_index.at(entry).offset;
+    for(int skip = int(record % IndexInterval); skip > 0 && offset >= 0; skip--)
+        offset = recordEnd(offset);
+    return offset;
+}
+
+qint64
+IRCChannelLog::recordEnd(qint64 offset) const
+{
+    if(offset + RecordHeaderSize > m_size)
+        return -1;
+
+    const uchar *record = at(offset);
+    const qint64 end = offset + 4 + qFromLittleEndian<quint32>(record);
+    const qint64 commandLengthOffset =
+        offset + 14 + qFromLittleEndian<quint16>(record + 12);
+    if(end > m_size || commandLengthOffset + 2 > end
+    || commandLengthOffset + 2
+       + qFromLittleEndian<quint16>(record + (commandLengthOffset - offset)) > end)
+    {
+        return -1;
+    }
+    return end;
+}
+
+qint64
+IRCChannelLog::recordTimestamp(qint64 offset) const
+{
+    return qFromLittleEndian<qint64>(at(offset) + 4);
+}
+
+void
+IRCChannelLog::decode(qint64 offset, qint64 end, Record &record) const
+{
+    const uchar *recordData = at(offset);
+    const char *data = reinterpret_cast<const char*>(recordData);
+    const int senderLength = qFromLittleEndian<quint16>(recordData + 12);
+    const int commandOffset = 14 + senderLength;
+    const int commandLength =
+        qFromLittleEndian<quint16>(recordData + commandOffset);
+    const int payloadOffset = commandOffset + 2 + commandLength;
+
+    record.offset = offset;
+    record.timestamp = recordTimestamp(offset);
+    record.sender = QString::fromUtf8(data + 14, senderLength);
+    record.command = QString::fromUtf8(data + commandOffset + 2, commandLength);
+    record.payload = QString::fromUtf8(data + payloadOffset,
+                                       int(end - offset) - payloadOffset);
+}
+
+void
+IRCChannelLog::addIndexEntry(qint64 timestamp, qint64 offset)
+{
+    IndexEntry entry;
+    entry.timestamp = timestamp;
+    entry.offset = offset;
+
+    uchar data[IndexEntrySize];
+    qToLittleEndian<qint64>(timestamp, data);
+    qToLittleEndian<qint64>(offset, data + 8);
+    m_indexFile.seek(qint64(m_index.size()) * IndexEntrySize);
+    m_indexFile.write(reinterpret_cast<const char*>(data), IndexEntrySize);
+    m_index.append(entry);
+}
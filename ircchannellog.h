@@ -0,0 +1,123 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QFile>
+
+/**
+  * \class IRCChannelLog
+  * Persistent, append-only log of the messages of a channel.
+  *
+  * The log file starts with an eight byte magic followed by records. Every
+  * record is a 32 bit length of the rest of the record, the time of arrival
+  * in milliseconds since the epoch as 64 bit value, the UTF-8 encoded
+  * sender and command, each preceded by a 16 bit length, and the UTF-8
+  * encoded payload filling the rest. All integers are little endian.
+  *
+  * A sparse index file next to the log holds the arrival time and offset of
+  * every IndexInterval-th record. Finding a record by number or by time is
+  * a lookup in the index followed by skipping less than IndexInterval
+  * records. Records are read straight from a memory mapping of the log;
+  * records appended after the log was mapped are read from a copy kept in
+  * memory until it grows large enough to map the log again.
+  */
+class IRCChannelLog {
+public:
+    struct Record {
+        /** Position of the record in the log, see readAt(). */
+        qint64  offset;
+        qint64  timestamp;
+        QString sender;
+        QString command;
+        QString payload;
+    };
+
+    /** Every this many records an entry is added to the index. */
+    static const int IndexInterval = 256;
+
+    IRCChannelLog();
+    ~IRCChannelLog();
+
+    /**
+      * Opens or creates the log at \a fileName. A record that has only been
+      * written partially, for example because of a crash, is cut off.
+      */
+    bool open(const QString& fileName);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+
+    /** Number of records in the log. */
+    qint64 recordCount() const;
+
+    /** Size of the log in bytes, which is where the next record goes. */
+    qint64 size() const;
+
+    /** Appends a record to the log. */
+    bool append(qint64 timestamp, const QString& sender,
+                const QString& command, const QString& payload);
+
+    /** Writes appended records through to the file. */
+    void flush();
+
+    /**
+      * Reads up to \a count records, starting with record number \a first.
+      * Records that do not exist are left out.
+      */
+    QVector<Record> read(qint64 first, int count);
+
+    /**
+      * Reads the record at \a offset, as found in Record::offset or size()
+      * before appending. Unlike reading by number, this does not have to
+      * skip any records.
+      */
+    bool readAt(qint64 offset, Record& record);
+
+    /**
+      * Returns the number of the first record that arrived at or after
+      * \a timestamp, or recordCount() if there is none.
+      */
+    qint64 indexOfTime(qint64 timestamp);
+
+private:
+    struct IndexEntry {
+        qint64 timestamp;
+        qint64 offset;
+    };
+
+    bool map();
+    const uchar *at(qint64 offset) const;
+    qint64 offsetOf(qint64 record);
+    qint64 recordEnd(qint64 offset) const;
+    qint64 recordTimestamp(qint64 offset) const;
+    void decode(qint64 offset, qint64 end, Record& record) const;
+    void addIndexEntry(qint64 timestamp, qint64 offset);
+
+    QFile               m_file;
+    QFile               m_indexFile;
+    QVector<IndexEntry> m_index;
+    qint64              m_recordCount;
+    qint64              m_size;
+    uchar *             m_map;
+    qint64              m_mapSize;
+    QByteArray          m_tail;
+};
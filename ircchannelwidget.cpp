@@ -17,6 +17,7 @@
 
 // Own includes
 #include "ircchannelwidget.h"
+#include "ircmessagedelegate.h"
 #include "ui_ircchannelwidget.h"
 
 IRCChannelWidget::IRCChannelWidget(IRCChannel *ircChannelProxy, QWidget *parent) :
@@ -25,9 +26,18 @@ IRCChannelWidget::IRCChannelWidget(IRCChannel *ircChannelProxy, QWidget *parent)
 {
     ui->setupUi(this);
     m_ircChannelProxy = ircChannelProxy;
+    m_channelDocument = IRCChannelDocument::forChannel(ircChannelProxy);
 
-    ui->chatTextEdit->setDocument(m_ircChannelProxy->conversationModel());
+    ui->chatTextEdit->setDocument(m_channelDocument->conversationModel());
     ui->usersListView->setModel(m_ircChannelProxy->userListModel());
+
+    m_followConversation = true;
+    m_viewMode = DocumentView;
+    m_messageListView = 0;
+    connect(m_channelDocument, SIGNAL(conversationUpdated()),
+            this, SLOT(handleConversationUpdated()));
+    connect(ui->chatTextEdit->verticalScrollBar(), SIGNAL(valueChanged(int)),
+            this, SLOT(handleChatScrolled(int)));
 }
 
 IRCChannelWidget::~IRCChannelWidget()
@@ -40,11 +50,95 @@ IRCChannel *IRCChannelWidget::ircChannelProxy()
     return m_ircChannelProxy;
 }
 
+IRCChannelDocument *IRCChannelWidget::channelDocument()
+{
+    return m_channelDocument;
+}
+
+void IRCChannelWidget::setViewMode(ViewMode viewMode)
+{
+    if(viewMode == MessageListView && !m_messageListView) {
+        m_messageListView = new QListView;
+        m_messageListView->setUniformItemSizes(true);
+        m_messageListView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        m_messageListView->setSelectionMode(QAbstractItemView::NoSelection);
+        m_messageListView->setItemDelegate(new IRCMessageDelegate(m_messageListView));
+        m_messageListView->setModel(m_channelDocument->messageModel());
+        ui->horizontalLayout->insertWidget(0, m_messageListView);
+
+        connect(m_messageListView->verticalScrollBar(), SIGNAL(valueChanged(int)),
+                this, SLOT(handleMessageListScrolled(int)));
+    }
+
+    m_viewMode = viewMode;
+    ui->chatTextEdit->setVisible(viewMode == DocumentView);
+    if(m_messageListView) {
+        m_messageListView->setVisible(viewMode == MessageListView);
+    }
+    scrollToBottom();
+}
+
+IRCChannelWidget::ViewMode IRCChannelWidget::viewMode()
+{
+    return m_viewMode;
+}
+
 void IRCChannelWidget::scrollToBottom()
 {
-    if(ui->chatTextEdit->verticalScrollBar()) {
+    if(m_viewMode == MessageListView) {
+        m_messageListView->scrollToBottom();
+    } else if(ui->chatTextEdit->verticalScrollBar()) {
         ui->chatTextEdit->verticalScrollBar()->setValue(
                     ui->chatTextEdit->verticalScrollBar()->maximum());
     }
 }
 
+void IRCChannelWidget::handleConversationUpdated()
+{
+    // Only follow new messages if the user has not scrolled away from them.
+    if(m_followConversation) {
+        scrollToBottom();
+    }
+}
+
+void IRCChannelWidget::handleChatScrolled(int value)
+{
+    if(m_viewMode != DocumentView) {
+        return;
+    }
+
+    QScrollBar *scrollBar = ui->chatTextEdit->verticalScrollBar();
+    m_followConversation = (value == scrollBar->maximum());
+
+    if(m_followConversation) {
+        // Back at the bottom, lines paged in from the history may go again.
+        m_channelDocument->releasePagedHistory();
+    } else if(value == scrollBar->minimum() && m_channelDocument->hasOlderHistory()) {
+        // Page in older lines and keep the view where it was.
+        int maximum = scrollBar->maximum();
+        if(m_channelDocument->loadOlderHistory(HistoryPageSize) > 0) {
+            scrollBar->setValue(scrollBar->maximum() - maximum);
+        }
+    }
+}
+
+void IRCChannelWidget::handleMessageListScrolled(int value)
+{
+    if(m_viewMode != MessageListView) {
+        return;
+    }
+
+    QScrollBar *scrollBar = m_messageListView->verticalScrollBar();
+    m_followConversation = (value == scrollBar->maximum());
+
+    if(m_followConversation) {
+        m_channelDocument->releasePagedHistory();
+    } else if(value == scrollBar->minimum() && m_channelDocument->hasOlderMessages()) {
+        // Page in older messages and keep the row that was at the top there.
+        int loaded = m_channelDocument->loadOlderMessages(HistoryPageSize);
+        if(loaded > 0) {
+            m_messageListView->scrollTo(m_messageListView->model()->index(loaded, 0),
+                                        QAbstractItemView::PositionAtTop);
+        }
+    }
+}
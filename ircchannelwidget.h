@@ -19,10 +19,12 @@
 
 // Own includes
 #include "ircchannel.h"
+#include "ircchanneldocument.h"
 
 // Qt includes
 #include <QWidget>
 #include <QScrollBar>
+#include <QListView>
 
 namespace Ui {
     class IRCChannelWidget;
@@ -35,10 +37,35 @@ public:
     explicit IRCChannelWidget(IRCChannel *ircChannelProxy, QWidget *parent = 0);
     ~IRCChannelWidget();
 
+    IRCChannel *ircChannelProxy();
+    IRCChannelDocument *channelDocument();
+
+    enum ViewMode {
+        /** Rich text view of the conversation document. */
+        DocumentView,
+        /** List view of the message model that only lays out visible lines. */
+        MessageListView
+    };
+
+    void setViewMode(ViewMode viewMode);
+    ViewMode viewMode();
+
+    /** Number of lines paged in from the history at a time. */
+    static const int HistoryPageSize = 200;
+
+public slots:
     void scrollToBottom();
 
-    IRCChannel *ircChannelProxy();
+private slots:
+    void handleConversationUpdated();
+    void handleChatScrolled(int value);
+    void handleMessageListScrolled(int value);
+
 private:
     Ui::IRCChannelWidget *ui;
     IRCChannel *m_ircChannelProxy;
+    IRCChannelDocument *m_channelDocument;
+    bool m_followConversation;
+    ViewMode m_viewMode;
+    QListView *m_messageListView;
 };
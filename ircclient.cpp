@@ -17,42 +17,304 @@
 
 // Own includes
 #include "ircclient.h"
+#include "irctrace.h"
+
+// Qt includes
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QUrl>
+
+// Standard includes
+#include <string.h>
 
 IRCClient::IRCClient(QObject *parent) :
     QObject(parent) {
+    m_port = 0;
+    m_connectTime = -1;
+    m_connected = false;
     m_loggedIn = false;
-    connect(&m_tcpSocket, SIGNAL(connected()), this, SLOT(handleConnected()));
-    connect(&m_tcpSocket, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
-    connect(&m_tcpSocket, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
+    m_connecting = false;
+    m_autoReconnect = true;
+    m_userDisconnected = false;
+    m_reconnectAttempts = 0;
+    m_deviceAttached = false;
+
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, SIGNAL(timeout()), this, SLOT(startConnecting()));
+    m_lagCheckSent = -1;
+    m_maximumLag = DefaultMaximumLag;
+    m_lagClock.start();
+    m_lagTimer.setInterval(LagCheckInterval);
+    connect(&m_lagTimer, SIGNAL(timeout()), this, SLOT(checkLag()));
+    m_lagDeadlineTimer.setSingleShot(true);
+    connect(&m_lagDeadlineTimer, SIGNAL(timeout()), this, SLOT(handleLagDeadline()));
+    // Spread the reconnect attempts of clients started at the same time,
+    // without touching the random numbers of the application.
+    m_random.seed(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(quintptr(this)));
+    m_connection = 0;
+    m_networkThread = 0;
+    m_sendQueueDepth = 0;
+    m_nicknameAtom = IRCAtomTable::InvalidAtom;
+    m_userHostLength = DefaultUserHostLength;
+    qRegisterMetaType<QHostAddress>("QHostAddress");
+    qRegisterMetaType<IRCServerMessageBatch>("IRCServerMessageBatch");
+    m_metrics = QSharedPointer<IRCClientMetrics>(new IRCClientMetrics);
+    m_dispatchTimer.start();
+    createConnection(0);
+
+    m_lineBuffer.reserve(512);
+    m_messageBuffer.reserve(512);
+
+    for(int i = 0; i < IRCCommand::CodeCount; i++)
+        m_commandHandlers[i] = 0;
+    for(int i = 0; i < NumericHandlerCount; i++)
+        m_numericHandlers[i] = 0;
+
+    registerNumericHandler(IRCReply::Welcome, &IRCClient::handleWelcomeReply);
+    registerNumericHandler(IRCReply::ISupport, &IRCClient::handleISupportReply);
+    registerNumericHandler(IRCError::NicknameInUse, &IRCClient::handleNicknameInUseError);
+    registerNumericHandler(IRCError::NickCollision, &IRCClient::handleNicknameInUseError);
+    registerNumericHandler(IRCError::PasswordMismatch, &IRCClient::handlePasswordMismatchError);
+    registerNumericHandler(IRCReply::NameReply, &IRCClient::handleNameReply);
+    registerNumericHandler(IRCReply::EndOfNames, &IRCClient::handleEndOfNamesReply);
+
+    registerCommandHandler(IRCCommand::NickCode, &IRCClient::handleNickCommand);
+    registerCommandHandler(IRCCommand::QuitCode, &IRCClient::handleQuitCommand);
+    registerCommandHandler(IRCCommand::JoinCode, &IRCClient::handleJoinCommand);
+    registerCommandHandler(IRCCommand::PartCode, &IRCClient::handlePartCommand);
+    registerCommandHandler(IRCCommand::ModeCode, &IRCClient::handleModeCommand);
+    registerCommandHandler(IRCCommand::TopicCode, &IRCClient::handleTopicCommand);
+    registerCommandHandler(IRCCommand::KickCode, &IRCClient::handleKickCommand);
+    registerCommandHandler(IRCCommand::InviteCode, &IRCClient::handleInviteCommand);
+    registerCommandHandler(IRCCommand::PrivateMessageCode, &IRCClient::handlePrivateMessageCommand);
+    registerCommandHandler(IRCCommand::NoticeCode, &IRCClient::handleNoticeCommand);
+    registerCommandHandler(IRCCommand::PongCode, &IRCClient::handlePongCommand);
+    registerCommandHandler(IRCCommand::ErrorCode, &IRCClient::handleErrorCommand);
 }
 
 IRCClient::~IRCClient()
 {
+    switchSearchIndex(QString());
+
+    // A connection in another thread is deleted by its own thread.
+    m_connection->QObject::disconnect(this);
+    if(m_connection->thread() == QThread::currentThread())
+        delete m_connection;
+    else
+        m_connection->deleteLater();
+
     foreach(IRCChannel *ircChannelProxy, m_channels)
     {
         delete ircChannelProxy;
     }
 }
 
+void
+IRCClient::connectToHost(const QString& hostName, quint16 port, const QString& initialNick)
+{
+    // Channels of another server are not joined again.
+    if(hostName != m_hostName || port != m_port)
+        m_joinedChannels.clear();
+
+    switchSearchIndex(hostName);
+    m_hostName = hostName;
+    m_port = port;
+    setNickname(initialNick);
+    m_userDisconnected = false;
+    m_reconnectAttempts = 0;
+    startConnecting();
+}
+
 void
 IRCClient::connectToHost(const QHostAddress& host, quint16 port, const QString& initialNick)
 {
-    m_host = host;
-    m_nickname = initialNick;
-    m_tcpSocket.connectToHost(host, port);
+    connectToHost(host.toString(), port, initialNick);
 }
 
 void
 IRCClient::disconnect()
 {
-    m_tcpSocket.disconnect();
+    m_userDisconnected = true;
+    m_connecting = false;
+    m_reconnectTimer.stop();
+    QMetaObject::invokeMethod(m_connection, "disconnectFromHost");
 }
 
 void
 IRCClient::reconnect()
 {
-    disconnect();
-    connectToHost(m_host, m_port, m_nickname);
+    m_userDisconnected = false;
+    m_reconnectAttempts = 0;
+    startConnecting();
+}
+
+void
+IRCClient::startConnecting()
+{
+    prepareConnection();
+    m_deviceAttached = false;
+    QMetaObject::invokeMethod(m_connection, "connectToHost",
+                              Q_ARG(QString, m_hostName), Q_ARG(quint16, quint16(m_port)));
+}
+
+void
+IRCClient::connectToDevice(QIODevice *device, const QString &initialNick)
+{
+    // There is no server to reconnect to or to measure the lag of.
+    switchSearchIndex(QString());
+    m_hostName.clear();
+    m_port = 0;
+    m_joinedChannels.clear();
+    setNickname(initialNick);
+    m_userDisconnected = false;
+    m_reconnectAttempts = 0;
+
+    prepareConnection();
+    m_deviceAttached = true;
+    device->setParent(0);
+    device->moveToThread(m_connection->thread());
+    QMetaObject::invokeMethod(m_connection, "attachDevice", Q_ARG(QIODevice*, device));
+}
+
+void
+IRCClient::prepareConnection()
+{
+    if(m_connection->thread() != (m_networkThread ? m_networkThread : thread()))
+    {
+        m_connection->QObject::disconnect(this);
+        QMetaObject::invokeMethod(m_connection, "disconnectFromHost");
+        m_connection->deleteLater();
+        createConnection(m_networkThread);
+    }
+
+    // A connection that is still open is closed by the connection first.
+    // Its disconnect must not schedule another attempt.
+    m_connecting = true;
+    m_reconnectTimer.stop();
+    m_userHostLength = DefaultUserHostLength;
+}
+
+void
+IRCClient::setCaptureFileName(const QString &fileName)
+{
+    m_captureFileName = fileName;
+    if(fileName.isEmpty())
+        QMetaObject::invokeMethod(m_connection, "stopCapture");
+    else
+        QMetaObject::invokeMethod(m_connection, "startCapture", Q_ARG(QString, fileName));
+}
+
+QString
+IRCClient::captureFileName()
+{
+    return m_captureFileName;
+}
+
+void
+IRCClient::scheduleReconnect()
+{
+    if(!m_autoReconnect || m_userDisconnected || m_deviceAttached || m_hostName.isEmpty())
+        return;
+
+    // Exponential backoff, randomized between half and the full delay.
+    int delay = MaximumReconnectDelay;
+    if(m_reconnectAttempts < 16)
+        delay = qMin(MaximumReconnectDelay, InitialReconnectDelay << m_reconnectAttempts);
+    delay = std::uniform_int_distribution<int>(delay / 2, delay)(m_random);
+    m_reconnectAttempts++;
+
+    m_reconnectTimer.start(delay);
+    emit debugMessage(QString("Reconnecting to %1 in %2 ms").arg(m_hostName).arg(delay));
+    emit reconnectScheduled(delay);
+}
+
+void
+IRCClient::restoreChannels()
+{
+    // Pack as many channels into each JOIN as fit into a line. The lines are
+    // urgent, so they leave in a single write without being paced.
+    QByteArray line;
+    foreach(int channelAtom, m_joinedChannels)
+    {
+        QString channel = m_atomTable.name(channelAtom);
+        if(!line.isEmpty() && line.size() + 1 + utf8Length(channel) > MaximumLineLength)
+        {
+            sendLine(line, IRCSendQueue::Urgent);
+            line.resize(0);
+        }
+
+        if(line.isEmpty())
+        {
+            appendUtf8(line, IRCCommand::Join);
+            line.append(' ');
+        }
+        else
+        {
+            line.append(',');
+        }
+        appendUtf8(line, channel);
+    }
+
+    if(!line.isEmpty())
+        sendLine(line, IRCSendQueue::Urgent);
+}
+
+void
+IRCClient::setAutoReconnect(bool autoReconnect)
+{
+    m_autoReconnect = autoReconnect;
+    if(!autoReconnect)
+        m_reconnectTimer.stop();
+}
+
+bool
+IRCClient::autoReconnect()
+{
+    return m_autoReconnect;
+}
+
+void
+IRCClient::setMaximumLag(int milliseconds)
+{
+    m_maximumLag = milliseconds;
+
+    // Applies to a check that is already under way as well.
+    if(m_lagCheckSent >= 0)
+    {
+        if(milliseconds > 0)
+            m_lagDeadlineTimer.start(int(qMax<qint64>(0, m_lagCheckSent + milliseconds - m_lagClock.elapsed())));
+        else
+            m_lagDeadlineTimer.stop();
+    }
+}
+
+int
+IRCClient::maximumLag()
+{
+    return m_maximumLag;
+}
+
+int
+IRCClient::lag()
+{
+    return m_lagStatistics.last();
+}
+
+const IRCLagStatistics&
+IRCClient::lagStatistics()
+{
+    return m_lagStatistics;
+}
+
+QStringList
+IRCClient::joinedChannels()
+{
+    QStringList channels;
+    foreach(int channelAtom, m_joinedChannels)
+        channels.append(m_atomTable.name(channelAtom));
+    return channels;
 }
 
 bool
@@ -67,6 +329,12 @@ IRCClient::isLoggedIn()
     return m_loggedIn;
 }
 
+const QString&
+IRCClient::hostName()
+{
+    return m_hostName;
+}
+
 const QHostAddress&
 IRCClient::host()
 {
@@ -79,11 +347,114 @@ IRCClient::port()
     return m_port;
 }
 
+int
+IRCClient::connectTime()
+{
+    return m_connectTime;
+}
+
+void
+IRCClient::setFloodControl(int burst, int interval)
+{
+    QMetaObject::invokeMethod(m_connection, "setFloodControl",
+                              Q_ARG(int, burst), Q_ARG(int, interval));
+}
+
+int
+IRCClient::sendQueueDepth()
+{
+    return m_sendQueueDepth;
+}
+
+void
+IRCClient::setNetworkThread(QThread *thread)
+{
+    m_networkThread = thread;
+}
+
+QThread *
+IRCClient::networkThread()
+{
+    return m_connection->thread();
+}
+
+void
+IRCClient::createConnection(QThread *thread)
+{
+    m_connection = new IRCConnection;
+    m_connection->setMetrics(m_metrics);
+    if(thread)
+        m_connection->moveToThread(thread);
+
+    connect(m_connection, SIGNAL(connected(QHostAddress, int)),
+            this, SLOT(handleConnected(QHostAddress, int)));
+    connect(m_connection, SIGNAL(connectFailed(QString)),
+            this, SLOT(handleConnectFailed(QString)));
+    connect(m_connection, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+    connect(m_connection, SIGNAL(messagesReceived(IRCServerMessageBatch)),
+            this, SLOT(handleMessages(IRCServerMessageBatch)));
+    connect(m_connection, SIGNAL(sendQueueDepthChanged(int)),
+            this, SLOT(handleSendQueueDepthChanged(int)));
+    connect(m_connection, SIGNAL(captureFailed(QString)), this, SIGNAL(error(QString)));
+
+    // A capture continues on the new connection.
+    if(!m_captureFileName.isEmpty())
+        QMetaObject::invokeMethod(m_connection, "startCapture", Q_ARG(QString, m_captureFileName));
+}
+
 IRCChannel *IRCClient::ircChannel(const QString &channel)
 {
-    if(!m_channels.contains(channel))
-        m_channels[channel] = new IRCChannel(this, channel);
-    return m_channels[channel];
+    IRCChannel *&ircChannel = m_channels[m_atomTable.intern(channel)];
+    if(!ircChannel)
+        ircChannel = new IRCChannel(this, channel);
+    return ircChannel;
+}
+
+IRCChannel *
+IRCClient::findChannel(const QString &channel)
+{
+    return m_channels.value(m_atomTable.find(channel));
+}
+
+IRCAtomTable *
+IRCClient::atomTable()
+{
+    return &m_atomTable;
+}
+
+IRCSearchIndex *
+IRCClient::searchIndex()
+{
+    return &m_searchIndex;
+}
+
+void
+IRCClient::switchSearchIndex(const QString &hostName)
+{
+    if(hostName == m_hostName)
+        return;
+
+    // The index lives next to the channel logs of its server.
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/logs/";
+    if(!m_hostName.isEmpty())
+    {
+        QString fileName = directory
+                + QString::fromLatin1(QUrl::toPercentEncoding(m_hostName)) + "/search.qircidx";
+        QDir().mkpath(QFileInfo(fileName).absolutePath());
+        if(!m_searchIndex.save(fileName, &m_atomTable))
+            emit debugMessage(QString("Could not save the search index to %1").arg(fileName));
+    }
+
+    m_searchIndex.clear();
+    if(!hostName.isEmpty())
+        m_searchIndex.load(directory + QString::fromLatin1(QUrl::toPercentEncoding(hostName))
+                           + "/search.qircidx", &m_atomTable);
+}
+
+IRCClientMetrics *
+IRCClient::metrics()
+{
+    return m_metrics.data();
 }
 
 void
@@ -95,10 +466,7 @@ IRCClient::sendNicknameChangeRequest(const QString &nickname)
 void
 IRCClient::sendPrivateMessage(const QString &recipient, const QString &message)
 {
-    QStringList arguments;
-    arguments << recipient;
-    arguments << message;
-    sendIRCCommand(IRCCommand::PrivateMessage, arguments);
+    sendSplitMessage(IRCCommand::PrivateMessage, recipient, message);
 }
 
 const QString&
@@ -108,45 +476,119 @@ IRCClient::nickname()
 }
 
 void
-IRCClient::handleConnected()
+IRCClient::setNickname(const QString &nick)
+{
+    m_nickname = nick;
+    m_nicknameAtom = m_atomTable.intern(nick);
+}
+
+void
+IRCClient::handleConnected(const QHostAddress &peer, int milliseconds)
 {
+    m_connecting = false;
+    // Logging in has to finish within the lag limit, afterwards the lag
+    // checks take over.
+    if(m_maximumLag > 0 && !m_deviceAttached)
+        m_lagDeadlineTimer.start(m_maximumLag);
+    m_host = peer;
+    m_connectTime = milliseconds;
+    emit debugMessage(QString("Connected to %1 (%2) in %3 ms")
+                      .arg(m_hostName).arg(m_host.toString()).arg(milliseconds));
+
     m_connected = true;
     QStringList arguments;
     arguments << "na" << "0" << "0" << "na";
     sendIRCCommand(IRCCommand::User, arguments);
     sendNicknameChangeRequest(m_nickname);
-    emit connected(m_host.toString());
+    emit connected(m_hostName);
+}
+
+void
+IRCClient::handleConnectFailed(const QString &reason)
+{
+    m_connecting = false;
+    emit error(reason);
+    scheduleReconnect();
 }
 
 void
 IRCClient::handleDisconnected()
 {
     m_connected = false;
+    m_loggedIn = false;
+    m_sendQueueDepth = 0;
+    m_lagTimer.stop();
+    m_lagDeadlineTimer.stop();
+    m_lagCheckSent = -1;
     emit disconnected();
+
+    // Unless this is the end of the previous connection while a new one is
+    // being established, try to get back.
+    if(!m_connecting)
+        scheduleReconnect();
 }
 
 void
-IRCClient::handleReadyRead()
+IRCClient::handleMessages(const IRCServerMessageBatch &messages)
 {
-    QByteArray line;
-    do
+    IRC_TRACE_SCOPE("IRCClient::handleMessages");
+
+    for(int i = 0; i < messages.size(); i++)
     {
-        line = m_tcpSocket.readLine();
-        if(line.size())
-            handleIncomingLine(QString::fromUtf8(line.data()));
-        else
-            break;
+        qint64 dispatchStart = m_dispatchTimer.nsecsElapsed();
+        handleMessage(messages.at(i));
+        m_metrics->recordDispatchTime(m_dispatchTimer.nsecsElapsed() - dispatchStart);
     }
-    while(true);
+}
+
+void
+IRCClient::checkLag()
+{
+    if(!m_loggedIn || m_deviceAttached)
+        return;
+
+    // Still waiting for the previous answer, which has a deadline.
+    if(m_lagCheckSent >= 0)
+        return;
+
+    // The server echoes the token, which tells when we sent it.
+    m_lagCheckSent = m_lagClock.elapsed();
+    sendIRCCommand(IRCCommand::Ping,
+                   QStringList(QString("LAG%1").arg(m_lagCheckSent)), IRCSendQueue::Urgent);
+    if(m_maximumLag > 0)
+        m_lagDeadlineTimer.start(m_maximumLag);
+}
+
+void
+IRCClient::handleLagDeadline()
+{
+    // Either logging in or a lag check took too long.
+    if(!m_loggedIn || m_lagCheckSent >= 0)
+        dropLaggingConnection();
+}
+
+void
+IRCClient::dropLaggingConnection()
+{
+    emit error(QString("%1 did not answer within %2 ms.").arg(m_hostName).arg(m_maximumLag));
+    QMetaObject::invokeMethod(m_connection, "disconnectFromHost");
+}
+
+void
+IRCClient::handleSendQueueDepthChanged(int depth)
+{
+    m_sendQueueDepth = depth;
+    m_metrics->setSendQueueDepth(depth);
+    emit sendQueueDepthChanged(depth);
 }
 
 void
 IRCClient::handleNicknameChanged(const QString &oldNick, const QString &newNick)
 {
     // Check if our nickname changed.
-    if(oldNick == m_nickname)
+    if(m_atomTable.find(oldNick) == m_nicknameAtom)
     {
-        m_nickname = newNick;
+        setNickname(newNick);
         emit userNicknameChanged(m_nickname);
     }
     emit nicknameChanged(oldNick, newNick);
@@ -166,149 +608,417 @@ IRCClient::handleUserQuit(const QString &nick, const QString &reason)
 }
 
 void
-IRCClient::handleIncomingLine(const QString &line)
+IRCClient::registerCommandHandler(IRCCommand::Code command, MessageHandler handler)
+{
+    if(command > IRCCommand::UnknownCode && command < IRCCommand::CodeCount)
+        m_commandHandlers[command] = handler;
+}
+
+void
+IRCClient::registerNumericHandler(int numeric, MessageHandler handler)
 {
-    if(m_connected && !line.isEmpty())
+    if(numeric >= 0 && numeric < NumericHandlerCount)
+        m_numericHandlers[numeric] = handler;
+}
+
+void
+IRCClient::handleMessage(const IRCServerMessage &ircServerMessage)
+{
+    IRC_TRACE_SCOPE("IRCClient::handleMessage");
+    if(m_connected)
     {
-        IRCServerMessage ircServerMessage(line);
         if(ircServerMessage.isNumeric() == true)
         {
-            switch(ircServerMessage.numericValue())
-            {
-            case IRCReply::Welcome:
-                m_loggedIn = true;
-                emit userNicknameChanged(nickname());
-                emit loggedIn(nickname());
-                break;
-            case IRCError::NicknameInUse:
-            case IRCError::NickCollision:
-                // If we are already logged in, the user attempted to
-                // switch to a username that is already existing.
-                // In that case warn him.
-                if(isLoggedIn())
-                {
-                    emit error("The nickname is already in use.");
-                }
-                // Otherwise we are attempting to log in to the server.
-                // Change the nick so that we can at least log in.
-                else
-                {
-                    m_nickname += "_";
-                    sendNicknameChangeRequest(m_nickname);
-                }
-                break;
-            case IRCError::PasswordMismatch:
-                emit error("The password you provided is not correct.");
-                break;
-            case IRCReply::MessageOfTheDayStart:
-            case IRCReply::MessageOfTheDay:
-            case IRCReply::MessageOfTheDayEnd:
-            case IRCError::NoMessageOfTheDay:
-                break;
-            case IRCReply::NoTopic:
-            case IRCReply::Topic:
-                break;
-            case IRCReply::NameReply:
-                QString channel = ircServerMessage.parameter(2);
-                QString nickList = ircServerMessage.parameter(3);
-                ircChannel(channel)
-                    ->nameReply(nickList.split(
-                        QRegExp("\\s+"), QString::SkipEmptyParts));
-                break;
-            }
+            // Numerics are at most three digits, so this is always in range.
+            MessageHandler handler = m_numericHandlers[ircServerMessage.numericValue()];
+            if(handler)
+                (this->*handler)(ircServerMessage);
         }
         else
         {
-            QString command = ircServerMessage.command();
-            if(command == IRCCommand::Nick)
-            {
-                handleNicknameChanged(ircServerMessage.nick(), ircServerMessage.parameter(0));
-            }
-            else if(command == IRCCommand::Quit)
-            {
-                handleUserQuit(ircServerMessage.nick(), ircServerMessage.parameter(0));
-            }
-            else if(command == IRCCommand::Join)
-            {
-                handleUserJoined(ircServerMessage.nick(), ircServerMessage.parameter(0));
-            }
-            else if(command == IRCCommand::Part)
-            {
-                emit debugMessage("WRITEME: Received part.");
-                //emit part(ircEvent.getNick().toStdString().c_str(),
-                //           ircEvent.getParam(0).toStdString().c_str(),
-                //           ircEvent.getParam(1).toStdString().c_str());
-            }
-            else if(command == IRCCommand::Mode)
-            {
-                emit debugMessage("WRITEME: Received mode.");
-                //emit mode(&ircEvent);
-            }
-            else if(command == IRCCommand::Topic)
-            {
-                emit debugMessage
-                       (QString("WRITEME: Received topic: %1")
-                         .arg(ircServerMessage.parameter(0)));
-            }
-            else if(command == IRCCommand::Kick)
-            {
-                emit debugMessage("WRITEME: Received kick command.");
-            }
-            else if(command == IRCCommand::Invite)
-            {
-                emit debugMessage("WRITEME: Received invite command.");
-
-            }
-            else if(command == IRCCommand::PrivateMessage)
-            {
-                IRCChannel *channel = ircChannel(ircServerMessage.parameter(0));
-                if(channel) {
-                    channel->handleMessage(ircServerMessage.nick(), ircServerMessage.parameter(1));
-                }
-            }
-            else if(command == IRCCommand::Notice)
-            {
-                emit notification(ircServerMessage.nick(), ircServerMessage.parameter(1));
-            }
-            else if(command == IRCCommand::Ping)
-            {
-                sendIRCCommand(IRCCommand::Pong, QStringList(m_nickname));
-            }
-            else if(command == IRCCommand::Error)
-            {
-                emit error(ircServerMessage.parameter(0));
-            }
+            MessageHandler handler = m_commandHandlers[ircServerMessage.commandCode()];
+            if(handler)
+                (this->*handler)(ircServerMessage);
             else
-            {
-                emit debugMessage(QString("FIXME: Received unknown reply: %1").arg(command));
-            }
+                emit debugMessage(QString("FIXME: Received unknown reply: %1")
+                                  .arg(ircServerMessage.command()));
+        }
+    }
+}
+
+void
+IRCClient::handleWelcomeReply(const IRCServerMessage &message)
+{
+    // The welcome message usually ends with the full prefix the server knows
+    // us by: "Welcome to the Internet Relay Network nick!user@host".
+    QString welcome = message.parameter(message.parameterCount() - 1);
+    QString prefix = welcome.mid(welcome.lastIndexOf(QLatin1Char(' ')) + 1);
+    int userStart = prefix.indexOf(QLatin1Char('!'));
+    if(userStart > 0 && prefix.indexOf(QLatin1Char('@'), userStart) > userStart)
+        m_userHostLength = utf8Length(prefix) - utf8Length(prefix.left(userStart + 1));
+
+    m_loggedIn = true;
+    m_reconnectAttempts = 0;
+    restoreChannels();
+    m_lagCheckSent = -1;
+    m_lagDeadlineTimer.stop();
+    m_lagStatistics.clear();
+    m_lagTimer.start();
+    checkLag();
+    emit userNicknameChanged(nickname());
+    emit loggedIn(nickname());
+}
+
+void
+IRCClient::handleNicknameInUseError(const IRCServerMessage &message)
+{
+    Q_UNUSED(message);
+    // If we are already logged in, the user attempted to
+    // switch to a username that is already existing.
+    // In that case warn him.
+    if(isLoggedIn())
+    {
+        emit error("The nickname is already in use.");
+    }
+    // Otherwise we are attempting to log in to the server.
+    // Change the nick so that we can at least log in.
+    else
+    {
+        setNickname(m_nickname + "_");
+        sendNicknameChangeRequest(m_nickname);
+    }
+}
+
+void
+IRCClient::handlePasswordMismatchError(const IRCServerMessage &message)
+{
+    Q_UNUSED(message);
+    emit error("The password you provided is not correct.");
+}
+
+void
+IRCClient::handleNameReply(const IRCServerMessage &message)
+{
+    // Replies for channels we are not in, or for "*" when the server lists
+    // users outside of any channel, have no channel to go to.
+    IRCChannel *channel = m_channels.value(m_atomTable.find(message.parameter(2)));
+    if(!channel)
+        return;
+
+    QString nickList = message.parameter(3);
+    channel->nameReply(nickList.split(QRegExp("\\s+"), QString::SkipEmptyParts));
+}
+
+void
+IRCClient::handleEndOfNamesReply(const IRCServerMessage &message)
+{
+    IRCChannel *channel = m_channels.value(m_atomTable.find(message.parameter(1)));
+    if(channel)
+        channel->endOfNames();
+}
+
+void
+IRCClient::handleISupportReply(const IRCServerMessage &message)
+{
+    // The first parameter is our nick and the last one a human readable
+    // text, everything in between are tokens of the form KEY=VALUE.
+    for(int i = 1; i < message.parameterCount() - 1; i++)
+    {
+        QString token = message.parameter(i);
+        if(token.startsWith("CASEMAPPING="))
+        {
+            m_atomTable.setCaseMapping(
+                IRCAtomTable::caseMappingFromName(token.mid(12)));
         }
     }
 }
 
 void
-IRCClient::sendLine(const QString &line)
+IRCClient::handleNickCommand(const IRCServerMessage &message)
+{
+    handleNicknameChanged(message.nick(), message.parameter(0));
+}
+
+void
+IRCClient::handleQuitCommand(const IRCServerMessage &message)
+{
+    handleUserQuit(message.nick(), message.parameter(0));
+}
+
+void
+IRCClient::handleJoinCommand(const IRCServerMessage &message)
+{
+    // Names are decoded once and only looked up, so joins of others do not
+    // add to the atom table.
+    const QString nick = message.nick();
+    const QString channel = message.parameter(0);
+    if(m_atomTable.find(nick) == m_nicknameAtom)
+    {
+        m_joinedChannels.insert(m_atomTable.intern(channel));
+
+        // Our own join shows which user and host the server relays us with.
+        if(!message.host().isEmpty())
+            m_userHostLength = utf8Length(message.user()) + 1 + utf8Length(message.host());
+    }
+    handleUserJoined(nick, channel);
+}
+
+void
+IRCClient::handlePartCommand(const IRCServerMessage &message)
 {
+    if(m_atomTable.find(message.nick()) == m_nicknameAtom)
+        m_joinedChannels.remove(m_atomTable.find(message.parameter(0)));
+    emit debugMessage("WRITEME: Received part.");
+    //emit part(ircEvent.getNick().toStdString().c_str(),
+    //           ircEvent.getParam(0).toStdString().c_str(),
+    //           ircEvent.getParam(1).toStdString().c_str());
+}
+
+void
+IRCClient::handleModeCommand(const IRCServerMessage &message)
+{
+    Q_UNUSED(message);
+    emit debugMessage("WRITEME: Received mode.");
+    //emit mode(&ircEvent);
+}
+
+void
+IRCClient::handleTopicCommand(const IRCServerMessage &message)
+{
+    emit debugMessage
+           (QString("WRITEME: Received topic: %1")
+             .arg(message.parameter(0)));
+}
+
+void
+IRCClient::handleKickCommand(const IRCServerMessage &message)
+{
+    if(m_atomTable.find(message.parameter(1)) == m_nicknameAtom)
+        m_joinedChannels.remove(m_atomTable.find(message.parameter(0)));
+    emit debugMessage("WRITEME: Received kick command.");
+}
+
+void
+IRCClient::handleInviteCommand(const IRCServerMessage &message)
+{
+    Q_UNUSED(message);
+    emit debugMessage("WRITEME: Received invite command.");
+}
+
+void
+IRCClient::handlePrivateMessageCommand(const IRCServerMessage &message)
+{
+    IRCChannel *channel = ircChannel(message.parameter(0));
+    if(channel) {
+        channel->handleMessage(message.nick(), message.parameter(1));
+    }
+}
+
+void
+IRCClient::handleNoticeCommand(const IRCServerMessage &message)
+{
+    emit notification(message.nick(), message.parameter(1));
+}
+
+void
+IRCClient::handlePongCommand(const IRCServerMessage &message)
+{
+    // Lag checks carry the time they were sent.
+    QString token = message.parameter(message.parameterCount() - 1);
+    if(m_lagCheckSent < 0 || token != QString("LAG%1").arg(m_lagCheckSent))
+        return;
+
+    int milliseconds = int(m_lagClock.elapsed() - m_lagCheckSent);
+    m_lagCheckSent = -1;
+    m_lagDeadlineTimer.stop();
+    m_lagStatistics.addSample(milliseconds);
+    emit lagMeasured(milliseconds);
+
+    // An answer that came too late is as bad as none at all.
+    if(m_maximumLag > 0 && milliseconds > m_maximumLag)
+        dropLaggingConnection();
+}
+
+void
+IRCClient::handleErrorCommand(const IRCServerMessage &message)
+{
+    emit error(message.parameter(0));
+}
+
+void
+IRCClient::sendLine(const QByteArray &line, IRCSendQueue::Priority priority)
+{
+    IRC_TRACE_SCOPE("IRCClient::sendLine");
+    // The connection copies the line, so the buffers it comes from are
+    // never shared with the connection's thread and stay reusable.
     if(m_connected)
-        m_tcpSocket.write((line +  + "\r\n").toUtf8());
+        m_connection->postLine(line.constData(), line.size(), priority);
 }
 
 void
-IRCClient::sendIRCCommand(const QString &command, const QStringList &arguments)
+IRCClient::sendIRCCommand(const QString &command, const QStringList &arguments,
+                          IRCSendQueue::Priority priority)
 {
-    QString line = command;
+    if(!m_connected)
+        return;
+
+    // The line is serialized straight into a buffer that is reused for every
+    // message, so sending does not allocate once the buffer has grown.
+    m_lineBuffer.resize(0);
+    appendUtf8(m_lineBuffer, command);
     for(int i = 0; i < arguments.size(); i++)
     {
-        bool applyColon = false;
+        const QString &argument = arguments.at(i);
+        m_lineBuffer.append(' ');
         // Usually all parameters are separated by spaces.
         // The last parameter of the message may contain spaces, it is usually used
         // to transmit messages. In order to parse it correctly, if needs to be prefixed
         // with a colon, so the server knows to ignore all forthcoming spaces and has to treat
-        // all remaining characters as a single parameter. If we detect any whitespace in the
-        // last argument, prefix it with a colon:
-        if((i == arguments.size() - 1) && arguments.at(i).contains(QRegExp("\\s")))
-            applyColon = true;
-        line += QString(" %1%2").arg(applyColon ? ":" : "").arg(arguments.at(i));
+        // all remaining characters as a single parameter. The same applies if the
+        // last argument is empty or starts with a colon itself.
+        if(i == arguments.size() - 1
+           && (argument.isEmpty()
+               || argument.at(0) == QLatin1Char(':')
+               || argument.contains(QLatin1Char(' '))))
+            m_lineBuffer.append(':');
+        appendUtf8(m_lineBuffer, argument);
+    }
+    sendLine(m_lineBuffer, priority);
+}
+
+void
+IRCClient::sendSplitMessage(const QString &command, const QString &target,
+                            const QString &message)
+{
+    if(!m_connected)
+        return;
+
+    // The message is encoded once. Chunks are cut from the encoded bytes.
+    m_messageBuffer.resize(0);
+    appendUtf8(m_messageBuffer, message);
+    const char *data = m_messageBuffer.constData();
+    int size = m_messageBuffer.size();
+
+    // Leave room for at least one complete code point per line.
+    int maximum = qMax(4, maximumPayload(command, target));
+    int position = 0;
+    while(position < size)
+    {
+        // Explicit line breaks always end a chunk.
+        const char *lineBreak = static_cast<const char*>(
+                    memchr(data + position, '\n', size - position));
+        int end = lineBreak ? lineBreak - data : size;
+        int next = end + 1;
+
+        if(end - position > maximum)
+        {
+            end = position + maximum;
+            // Never cut a multi-byte sequence in half.
+            while((data[end] & 0xc0) == 0x80)
+                end--;
+            next = end;
+            // Prefer breaking at a space, unless that leaves a very short line.
+            for(int i = end; i > position + maximum / 2; i--)
+            {
+                if(data[i] == ' ')
+                {
+                    end = i;
+                    next = i + 1;
+                    break;
+                }
+            }
+        }
+
+        int chunkEnd = end;
+        if(chunkEnd > position && data[chunkEnd - 1] == '\r')
+            chunkEnd--;
+        if(chunkEnd > position)
+        {
+            m_lineBuffer.resize(0);
+            appendUtf8(m_lineBuffer, command);
+            m_lineBuffer.append(' ');
+            appendUtf8(m_lineBuffer, target);
+            m_lineBuffer.append(" :", 2);
+            m_lineBuffer.append(data + position, chunkEnd - position);
+            sendLine(m_lineBuffer, IRCSendQueue::Normal);
+        }
+        position = next;
+    }
+}
+
+int
+IRCClient::maximumPayload(const QString &command, const QString &target)
+{
+    // Other clients receive the message as
+    // ":nick!user@host COMMAND target :text\r\n", which the server cuts off
+    // at 512 bytes.
+    int prefix = 1 + utf8Length(m_nickname) + 1 + m_userHostLength + 1;
+    return 512 - prefix - utf8Length(command) - 1 - utf8Length(target) - 2 - 2;
+}
+
+int
+IRCClient::utf8Length(const QString &string)
+{
+    const ushort *in = reinterpret_cast<const ushort*>(string.constData());
+    const ushort *end = in + string.size();
+    int length = 0;
+    while(in < end)
+    {
+        uint c = *in++;
+        if(c < 0x80)
+            length += 1;
+        else if(c < 0x800)
+            length += 2;
+        else if(QChar::isHighSurrogate(c) && in < end && QChar::isLowSurrogate(*in))
+        {
+            length += 4;
+            in++;
+        }
+        else
+            length += 3;
+    }
+    return length;
+}
+
+void
+IRCClient::appendUtf8(QByteArray &buffer, const QString &string)
+{
+    // Every UTF-16 code unit takes at most three bytes in UTF-8.
+    int size = buffer.size();
+    buffer.resize(size + string.size() * 3);
+    char *out = buffer.data() + size;
+
+    const ushort *in = reinterpret_cast<const ushort*>(string.constData());
+    const ushort *end = in + string.size();
+    while(in < end)
+    {
+        uint c = *in++;
+        if(c < 0x80)
+        {
+            *out++ = char(c);
+        }
+        else if(c < 0x800)
+        {
+            *out++ = char(0xc0 | (c >> 6));
+            *out++ = char(0x80 | (c & 0x3f));
+        }
+        else if(QChar::isHighSurrogate(c) && in < end && QChar::isLowSurrogate(*in))
+        {
+            c = QChar::surrogateToUcs4(ushort(c), *in++);
+            *out++ = char(0xf0 | (c >> 18));
+            *out++ = char(0x80 | ((c >> 12) & 0x3f));
+            *out++ = char(0x80 | ((c >> 6) & 0x3f));
+            *out++ = char(0x80 | (c & 0x3f));
+        }
+        else
+        {
+            // Unpaired surrogates are replaced by U+FFFD.
+            if(QChar::isSurrogate(c))
+                c = 0xfffd;
+            *out++ = char(0xe0 | (c >> 12));
+            *out++ = char(0x80 | ((c >> 6) & 0x3f));
+            *out++ = char(0x80 | (c & 0x3f));
+        }
     }
-    sendLine(line);
+    buffer.resize(out - buffer.constData());
 }
@@ -23,20 +23,37 @@
 #include "ircreply.h"
 #include "ircerror.h"
 #include "ircchannel.h"
+#include "ircatomtable.h"
+#include "ircsearchindex.h"
+#include "ircsendqueue.h"
+#include "ircconnection.h"
+#include "irclagstatistics.h"
+#include "ircclientmetrics.h"
 
 // Qt includes
 #include <QObject>
 #include <QTcpSocket>
 #include <QHostInfo>
 #include <QStringList>
-#include <QTextDocument>
-#include <QStringListModel>
+#include <QThread>
+#include <QTimer>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+// Standard includes
+#include <random>
 
 /**
   * \class IRCClient
   * Implements an IRC client. This class can maintain a connection to one server.
   * In order to interface an IRC channel, use the ircChannelProxy-method to retrieve
   * a handle.
+  *
+  * The socket and the parser live in an IRCConnection, which may run in a
+  * network thread of its own. The client itself, its channels and all
+  * their models belong to the thread the client lives in and must only be
+  * used from there. Parsed messages are delivered to that thread in batches.
   */
 class IRCClient :
     public QObject {
@@ -48,17 +65,136 @@ public:
     const QString& nickname ();
     bool isConnected ();
     bool isLoggedIn ();
+    /** The name of the host this client connects to, as it was given. */
+    const QString& hostName();
+
+    /** The address of the server the client is connected to. */
     const QHostAddress& host();
     int port();
+
+    /**
+    * Milliseconds it took to resolve the host name and establish the
+    * current connection.
+    */
+    int connectTime();
     IRCChannel *ircChannel(const QString& channel);
-    void sendIRCCommand (const QString& command, const QStringList& arguments);
+
+    /** Returns the channel \a channel, or 0 if it has not been created. */
+    IRCChannel *findChannel(const QString& channel);
+
+    /**
+    * The table nick and channel names of this connection are interned in.
+    * It folds names with the case mapping announced by the server.
+    */
+    IRCAtomTable *atomTable ();
+
+    /**
+    * Index over the logged messages of all channels of this connection. It
+    * is kept next to the logs of the server between sessions.
+    */
+    IRCSearchIndex *searchIndex ();
+
+    /**
+    * Counters and timings of this connection. Recording into them is safe
+    * from any thread, snapshot() reads them.
+    */
+    IRCClientMetrics *metrics ();
+
+    void sendIRCCommand (const QString& command, const QStringList& arguments,
+                         IRCSendQueue::Priority priority = IRCSendQueue::Normal);
+
+    /**
+    * Configures outbound flood control.
+    * \arg burst Number of lines that may be sent back to back.
+    * \arg interval Milliseconds between lines once the burst is used up,
+    * 0 turns pacing off.
+    */
+    void setFloodControl (int burst, int interval);
+
+    /** Number of outgoing lines waiting to be written. */
+    int sendQueueDepth ();
+
+    /**
+    * Runs the socket and the parser of this client in \a thread, or in the
+    * thread of the client if it is 0. The thread has to run an event loop
+    * for as long as the client exists. Takes effect with the next connect.
+    */
+    void setNetworkThread (QThread *thread);
+    QThread *networkThread ();
+
+    /** Milliseconds before the first attempt to reestablish a lost connection. */
+    static const int InitialReconnectDelay = 1000;
+
+    /** Upper bound of the delay between attempts to reestablish a connection. */
+    static const int MaximumReconnectDelay = 5 * 60 * 1000;
+
+    /**
+    * Whether lost connections are reestablished automatically. The delay
+    * between attempts doubles with every failed attempt, randomized so that
+    * many clients do not return at once after a netsplit. On by default.
+    */
+    void setAutoReconnect (bool autoReconnect);
+    bool autoReconnect ();
+
+    /**
+    * Records the raw traffic of the connection into \a fileName from now
+    * on, for playing it back with IRCReplayDevice. A capture already in the
+    * file is continued, so one capture covers all reconnects. An empty name
+    * stops recording.
+    */
+    void setCaptureFileName (const QString& fileName);
+    QString captureFileName ();
+
+    /** Channels we are in, which are joined again after reconnecting. */
+    QStringList joinedChannels ();
+
+    /** Milliseconds between two measurements of the round trip time. */
+    static const int LagCheckInterval = 30 * 1000;
+
+    /** Default for setMaximumLag(). */
+    static const int DefaultMaximumLag = 60 * 1000;
+
+    /**
+    * Round trip time above which the connection is considered stuck and is
+    * reestablished. The same limit applies to logging in after connecting.
+    * Since lag checks keep going while logged in, this is also how a dead
+    * connection is detected. Passing 0 turns this off.
+    */
+    void setMaximumLag (int milliseconds);
+    int maximumLag ();
+
+    /** The most recently measured round trip time in ms, or -1 if unknown. */
+    int lag ();
+
+    /** Recent round trip times of this connection. */
+    const IRCLagStatistics& lagStatistics ();
 
 public slots:
+    /**
+    * Resolves \a hostName and connects to the first of its addresses that
+    * accepts a connection, without blocking.
+    */
+    void connectToHost (const QString& hostName, quint16 port, const QString& initialNick);
     void connectToHost (const QHostAddress& host, quint16 port, const QString& initialNick);
+    /** Closes the connection. It is not reestablished automatically. */
     void disconnect ();
+
+    /** Closes the connection and connects to the same server again. */
     void reconnect ();
 
+    /**
+    * Logs in over \a device instead of a connection to a server, typically
+    * an IRCReplayDevice. The device has to be open and must not have a
+    * parent; the client takes ownership of it.
+    */
+    void connectToDevice (QIODevice *device, const QString& initialNick);
+
     void sendNicknameChangeRequest (const QString &nickname);
+    /**
+    * Sends a message to a channel or user. Messages that would not fit into
+    * a single line once the server has added our prefix are split up, at
+    * line breaks and preferably at spaces, and paced by the send queue.
+    */
     void sendPrivateMessage (const QString &recipient, const QString &message);
 
 signals:
@@ -132,25 +268,136 @@ signals:
     */
     void userList (const QString& channel, const QStringList& list);
 
+    /**
+    * Sent when the number of outgoing lines waiting to be written changed.
+    * \arg depth The number of waiting lines.
+    */
+    void sendQueueDepthChanged (int depth);
+
+    /**
+    * Sent when a lost connection is going to be reestablished.
+    * \arg milliseconds The time until the next attempt.
+    */
+    void reconnectScheduled (int milliseconds);
+
+    /**
+    * Sent when the server answered one of our lag checks.
+    * \arg milliseconds The round trip time.
+    */
+    void lagMeasured (int milliseconds);
+
     void debugMessage (const QString& message);
 
 private slots:
-    void handleConnected ();
+    void handleConnected (const QHostAddress& peer, int milliseconds);
+    void handleConnectFailed (const QString& reason);
     void handleDisconnected ();
-    void handleReadyRead ();
+    void handleMessages (const IRCServerMessageBatch& messages);
+    void handleSendQueueDepthChanged (int depth);
+    void checkLag ();
+    void handleLagDeadline ();
+    void startConnecting ();
+
+protected:
+    /** Handles a single parsed message from the server. */
+    typedef void (IRCClient::*MessageHandler)(const IRCServerMessage& message);
+
+    /** Number of slots in the numeric reply table, covering 000 to 999. */
+    static const int NumericHandlerCount = 1000;
+
+    /**
+    * Installs \a handler for all incoming messages carrying \a command,
+    * replacing any previous handler for it.
+    */
+    void registerCommandHandler (IRCCommand::Code command, MessageHandler handler);
+
+    /**
+    * Installs \a handler for all incoming numeric replies \a numeric,
+    * replacing any previous handler for it.
+    */
+    void registerNumericHandler (int numeric, MessageHandler handler);
 
 private:
+    void handleWelcomeReply (const IRCServerMessage& message);
+    void handleNicknameInUseError (const IRCServerMessage& message);
+    void handlePasswordMismatchError (const IRCServerMessage& message);
+    void handleNameReply (const IRCServerMessage& message);
+    void handleEndOfNamesReply (const IRCServerMessage& message);
+    void handleISupportReply (const IRCServerMessage& message);
+
+    void handleNickCommand (const IRCServerMessage& message);
+    void handleQuitCommand (const IRCServerMessage& message);
+    void handleJoinCommand (const IRCServerMessage& message);
+    void handlePartCommand (const IRCServerMessage& message);
+    void handleModeCommand (const IRCServerMessage& message);
+    void handleTopicCommand (const IRCServerMessage& message);
+    void handleKickCommand (const IRCServerMessage& message);
+    void handleInviteCommand (const IRCServerMessage& message);
+    void handlePrivateMessageCommand (const IRCServerMessage& message);
+    void handleNoticeCommand (const IRCServerMessage& message);
+    void handlePongCommand (const IRCServerMessage& message);
+    void handleErrorCommand (const IRCServerMessage& message);
+
     void handleNicknameChanged (const QString& oldNick, const QString& newNick);
     void handleUserJoined (const QString& nick, const QString& channel);
     void handleUserQuit (const QString& nick, const QString& reason);
-    void handleIncomingLine (const QString& line);
-    void sendLine (const QString& line);
+    void handleMessage (const IRCServerMessage& message);
+    void createConnection (QThread *thread);
+    void prepareConnection ();
+    void scheduleReconnect ();
+    void switchSearchIndex (const QString& hostName);
+    void dropLaggingConnection ();
+    void restoreChannels ();
+    void setNickname (const QString& nick);
+    void sendLine (const QByteArray& line, IRCSendQueue::Priority priority);
+    void sendSplitMessage (const QString& command, const QString& target, const QString& message);
+    int maximumPayload (const QString& command, const QString& target);
+    static int utf8Length (const QString& string);
+    static void appendUtf8 (QByteArray& buffer, const QString& string);
+
+    /**
+      * Assumed length of the "user@host" part of our prefix until the server
+      * tells us: a ten character user name and a 63 character host name.
+      */
+    static const int DefaultUserHostLength = 10 + 1 + 63;
+
+    /** Longest line a server accepts, without the line terminator. */
+    static const int MaximumLineLength = 512 - 2;
 
+    QString                                   m_hostName;
     QHostAddress                              m_host;
     int                                       m_port;
+    int                                       m_connectTime;
     QString                                   m_nickname;
+    int                                       m_nicknameAtom;
     bool                                      m_connected;
     bool                                      m_loggedIn;
-    QTcpSocket                                m_tcpSocket;
-    QMap<QString, IRCChannel*>       m_channels;
+    bool                                      m_connecting;
+    bool                                      m_autoReconnect;
+    bool                                      m_userDisconnected;
+    int                                       m_reconnectAttempts;
+    QTimer                                    m_reconnectTimer;
+    bool                                      m_deviceAttached;
+    std::minstd_rand                          m_random;
+    QString                                   m_captureFileName;
+    QSet<int>                                 m_joinedChannels;
+    QTimer                                    m_lagTimer;
+    QTimer                                    m_lagDeadlineTimer;
+    QElapsedTimer                             m_lagClock;
+    qint64                                    m_lagCheckSent;
+    int                                       m_maximumLag;
+    IRCLagStatistics                          m_lagStatistics;
+    QSharedPointer<IRCClientMetrics>          m_metrics;
+    QElapsedTimer                             m_dispatchTimer;
+    IRCConnection                            *m_connection;
+    QThread                                  *m_networkThread;
+    int                                       m_sendQueueDepth;
+    QByteArray                                m_lineBuffer;
+    QByteArray                                m_messageBuffer;
+    int                                       m_userHostLength;
+    IRCAtomTable                              m_atomTable;
+    IRCSearchIndex                            m_searchIndex;
+    QHash<int, IRCChannel*>                   m_channels;
+    MessageHandler                            m_commandHandlers[IRCCommand::CodeCount];
+    MessageHandler                            m_numericHandlers[NumericHandlerCount];
 };
@@ -0,0 +1,194 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircclientmetrics.h"
+
+// Qt includes
+#include <QtAlgorithms>
+#include <QMutexLocker>
+
+IRCMetricsHistogram::Snapshot::Snapshot() :
+    count(0),
+    sum(0),
+    buckets(BucketCount, 0)
+{
+}
+
+IRCMetricsHistogram::IRCMetricsHistogram()
+{
+}
+
+void
+IRCMetricsHistogram::record(quint64 value)
+{
+    int bucket = value ? 64 - qCountLeadingZeroBits(value) : 0;
+    m_buckets[qMin(bucket, BucketCount - 1)].fetchAndAddRelaxed(1);
+    m_sum.fetchAndAddRelaxed(value);
+    m_count.fetchAndAddRelaxed(1);
+}
+
+IRCMetricsHistogram::Snapshot
+IRCMetricsHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.count = m_count.load();
+    snapshot.sum = m_sum.load();
+    for(int i = 0; i < BucketCount; i++)
+        snapshot.buckets[i] = m_buckets[i].load();
+    return snapshot;
+}
+
+IRCClientMetrics::Snapshot::Snapshot() :
+    uptime(0),
+    linesReceived(0),
+    bytesReceived(0),
+    linesSent(0),
+    bytesSent(0),
+    sendQueueDepth(0),
+    maximumSendQueueDepth(0)
+{
+}
+
+static double
+perSecond(quint64 current, quint64 earlier, qint64 milliseconds)
+{
+    if(milliseconds <= 0)
+        return 0;
+    return double(current - earlier) * 1000 / milliseconds;
+}
+
+double
+IRCClientMetrics::Snapshot::linesReceivedPerSecond(const Snapshot &earlier) const
+{
+    return perSecond(linesReceived, earlier.linesReceived, uptime - earlier.uptime);
+}
+
+double
+IRCClientMetrics::Snapshot::bytesReceivedPerSecond(const Snapshot &earlier) const
+{
+    return perSecond(bytesReceived, earlier.bytesReceived, uptime - earlier.uptime);
+}
+
+double
+IRCClientMetrics::Snapshot::linesSentPerSecond(const Snapshot &earlier) const
+{
+    return perSecond(linesSent, earlier.linesSent, uptime - earlier.uptime);
+}
+
+double
+IRCClientMetrics::Snapshot::bytesSentPerSecond(const Snapshot &earlier) const
+{
+    return perSecond(bytesSent, earlier.bytesSent, uptime - earlier.uptime);
+}
+
+IRCClientMetrics::IRCClientMetrics()
+{
+    m_uptime.start();
+}
+
+IRCClientMetrics::~IRCClientMetrics()
+{
+    qDeleteAll(m_renderTime);
+}
+
+void
+IRCClientMetrics::recordReceived(int lines, qint64 bytes)
+{
+    m_linesReceived.fetchAndAddRelaxed(lines);
+    m_bytesReceived.fetchAndAddRelaxed(bytes);
+}
+
+void
+IRCClientMetrics::recordSent(int lines, qint64 bytes)
+{
+    m_linesSent.fetchAndAddRelaxed(lines);
+    m_bytesSent.fetchAndAddRelaxed(bytes);
+}
+
+void
+IRCClientMetrics::recordCommand(IRCCommand::Code code)
+{
+    m_commandCounts[code].fetchAndAddRelaxed(1);
+}
+
+void
+IRCClientMetrics::recordNumeric(int numeric)
+{
+    if(numeric >= 0 && numeric <= MaximumNumeric)
+        m_numericCounts[numeric].fetchAndAddRelaxed(1);
+}
+
+void
+IRCClientMetrics::recordParseTime(qint64 nanoseconds)
+{
+    m_parseTime.record(quint64(qMax(Q_INT64_C(0), nanoseconds)));
+}
+
+void
+IRCClientMetrics::recordDispatchTime(qint64 nanoseconds)
+{
+    m_dispatchTime.record(quint64(qMax(Q_INT64_C(0), nanoseconds)));
+}
+
+void
+IRCClientMetrics::recordRenderTime(const QString &channel, qint64 nanoseconds)
+{
+    QMutexLocker locker(&m_renderTimeMutex);
+    IRCMetricsHistogram *&histogram = m_renderTime[channel];
+    if(!histogram)
+        histogram = new IRCMetricsHistogram;
+    histogram->record(quint64(qMax(Q_INT64_C(0), nanoseconds)));
+}
+
+void
+IRCClientMetrics::setSendQueueDepth(int depth)
+{
+    m_sendQueueDepth.store(depth);
+    int maximum = m_maximumSendQueueDepth.load();
+    while(depth > maximum && !m_maximumSendQueueDepth.testAndSetRelaxed(maximum, depth))
+        maximum = m_maximumSendQueueDepth.load();
+}
+
+IRCClientMetrics::Snapshot
+IRCClientMetrics::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.uptime = m_uptime.elapsed();
+    snapshot.linesReceived = m_linesReceived.load();
+    snapshot.bytesReceived = m_bytesReceived.load();
+    snapshot.linesSent = m_linesSent.load();
+    snapshot.bytesSent = m_bytesSent.load();
+
+    snapshot.commandCounts.resize(IRCCommand::CodeCount);
+    for(int i = 0; i < IRCCommand::CodeCount; i++)
+        snapshot.commandCounts[i] = m_commandCounts[i].load();
+    snapshot.numericCounts.resize(MaximumNumeric + 1);
+    for(int i = 0; i <= MaximumNumeric; i++)
+        snapshot.numericCounts[i] = m_numericCounts[i].load();
+
+    snapshot.sendQueueDepth = m_sendQueueDepth.load();
+    snapshot.maximumSendQueueDepth = m_maximumSendQueueDepth.load();
+    snapshot.parseTime = m_parseTime.snapshot();
+    snapshot.dispatchTime = m_dispatchTime.snapshot();
+
+    QMutexLocker locker(&m_renderTimeMutex);
+    QHash<QString, IRCMetricsHistogram*>::const_iterator i;
+    for(i = m_renderTime.constBegin(); i != m_renderTime.constEnd(); ++i)
+        snapshot.renderTime.insert(i.key(), i.value()->snapshot());
+    return snapshot;
+}
@@ -0,0 +1,133 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "irccommand.h"
+
+// Qt includes
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/**
+  * \class IRCMetricsHistogram
+  * Counts values in buckets of powers of two. Recording is a handful of
+  * relaxed atomic additions, so it can be done from any thread.
+  */
+class IRCMetricsHistogram {
+public:
+    /** Bucket i holds the values below 2^i that do not fit into bucket i-1. */
+    static const int BucketCount = 40;
+
+    struct Snapshot {
+        Snapshot();
+
+        quint64          count;
+        quint64          sum;
+        QVector<quint64> buckets;
+    };
+
+    IRCMetricsHistogram();
+
+    void record(quint64 value);
+    Snapshot snapshot() const;
+
+private:
+    Q_DISABLE_COPY(IRCMetricsHistogram)
+
+    QAtomicInteger<quint64> m_count;
+    QAtomicInteger<quint64> m_sum;
+    QAtomicInteger<quint64> m_buckets[BucketCount];
+};
+
+/**
+  * \class IRCClientMetrics
+  * Counters of a single client: traffic in both directions, commands
+  * received, how long parsing, dispatching and rendering take and how many
+  * lines wait to be sent. The network side records from its own thread.
+  * Everything is cheap enough to stay on all the time; times are in
+  * nanoseconds.
+  */
+class IRCClientMetrics {
+public:
+    /** Highest numeric reply that is counted individually. */
+    static const int MaximumNumeric = 999;
+
+    struct Snapshot {
+        Snapshot();
+
+        /** Milliseconds since the metrics were created. */
+        qint64                                         uptime;
+        quint64                                        linesReceived;
+        quint64                                        bytesReceived;
+        quint64                                        linesSent;
+        quint64                                        bytesSent;
+        /** Received commands, indexed by IRCCommand::Code. */
+        QVector<quint64>                               commandCounts;
+        /** Received numeric replies, indexed by their number. */
+        QVector<quint64>                               numericCounts;
+        int                                            sendQueueDepth;
+        int                                            maximumSendQueueDepth;
+        IRCMetricsHistogram::Snapshot                  parseTime;
+        IRCMetricsHistogram::Snapshot                  dispatchTime;
+        /** Time spent displaying each batch, per channel name. */
+        QHash<QString, IRCMetricsHistogram::Snapshot>  renderTime;
+
+        /** Rates over the time since the \a earlier snapshot was taken. */
+        double linesReceivedPerSecond(const Snapshot& earlier) const;
+        double bytesReceivedPerSecond(const Snapshot& earlier) const;
+        double linesSentPerSecond(const Snapshot& earlier) const;
+        double bytesSentPerSecond(const Snapshot& earlier) const;
+    };
+
+    IRCClientMetrics();
+    ~IRCClientMetrics();
+
+    void recordReceived(int lines, qint64 bytes);
+    void recordSent(int lines, qint64 bytes);
+    void recordCommand(IRCCommand::Code code);
+    void recordNumeric(int numeric);
+    void recordParseTime(qint64 nanoseconds);
+    void recordDispatchTime(qint64 nanoseconds);
+    void recordRenderTime(const QString& channel, qint64 nanoseconds);
+    void setSendQueueDepth(int depth);
+
+    Snapshot snapshot() const;
+
+private:
+    Q_DISABLE_COPY(IRCClientMetrics)
+
+    QElapsedTimer                           m_uptime;
+    QAtomicInteger<quint64>                 m_linesReceived;
+    QAtomicInteger<quint64>                 m_bytesReceived;
+    QAtomicInteger<quint64>                 m_linesSent;
+    QAtomicInteger<quint64>                 m_bytesSent;
+    QAtomicInteger<quint64>                 m_commandCounts[IRCCommand::CodeCount];
+    QAtomicInteger<quint64>                 m_numericCounts[MaximumNumeric + 1];
+    QAtomicInt                              m_sendQueueDepth;
+    QAtomicInt                              m_maximumSendQueueDepth;
+    IRCMetricsHistogram                     m_parseTime;
+    IRCMetricsHistogram                     m_dispatchTime;
+    // Rendering happens once per frame at most, a lock is fine there.
+    mutable QMutex                          m_renderTimeMutex;
+    QHash<QString, IRCMetricsHistogram*>    m_renderTime;
+};
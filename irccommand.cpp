@@ -0,0 +1,181 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "irccommand.h"
+
+// Qt includes
+#include <QtGlobal>
+
+namespace {
+
+/**
+  * FNV-1a over an upper case command name. Being constexpr, it is evaluated
+  * by the compiler for every case label below; a collision between two
+  * commands shows up as a duplicate case value and fails the build.
+  */
+constexpr quint32
+commandHash (const char *name, quint32 hash = 2166136261u)
+{
+    return *name ? commandHash (name + 1, (hash ^ quint8 (*name)) * 16777619u)
+                 : hash;
+}
+
+inline char
+toUpper (char c)
+{
+    return (c >= 'a' && c <= 'z') ? char (c - 'a' + 'A') : c;
+}
+
+bool
+matches (const char *data, int length, const char *name)
+{
+    int i = 0;
+    for (; i < length; i++)
+        if (!name[i] || toUpper (data[i]) != name[i])
+            return false;
+    return name[i] == 0;
+}
+
+}
+
+namespace IRCCommand {
+
+Code
+code (const char *data, int length)
+{
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ quint8 (toUpper (data[i]))) * 16777619u;
+
+#define IRC_COMMAND_CODE(name, value) \
+    case commandHash (name): \
+        return matches (data, length, name) ? value : UnknownCode;
+
+    switch (hash)
+    {
+    IRC_COMMAND_CODE ("PASS", PasswordCode)
+    IRC_COMMAND_CODE ("NICK", NickCode)
+    IRC_COMMAND_CODE ("USER", UserCode)
+    IRC_COMMAND_CODE ("OPER", OperationCode)
+    IRC_COMMAND_CODE ("SERVICE", ServiceCode)
+    IRC_COMMAND_CODE ("QUIT", QuitCode)
+    IRC_COMMAND_CODE ("SQUIT", ServerQuitCode)
+    IRC_COMMAND_CODE ("JOIN", JoinCode)
+    IRC_COMMAND_CODE ("PART", PartCode)
+    IRC_COMMAND_CODE ("MODE", ModeCode)
+    IRC_COMMAND_CODE ("TOPIC", TopicCode)
+    IRC_COMMAND_CODE ("NAMES", NamesCode)
+    IRC_COMMAND_CODE ("LIST", ListCode)
+    IRC_COMMAND_CODE ("INVITE", InviteCode)
+    IRC_COMMAND_CODE ("KICK", KickCode)
+    IRC_COMMAND_CODE ("PRIVMSG", PrivateMessageCode)
+    IRC_COMMAND_CODE ("NOTICE", NoticeCode)
+    IRC_COMMAND_CODE ("MOTD", MessageOfTheDayCode)
+    IRC_COMMAND_CODE ("LUSERS", ListUsersCode)
+    IRC_COMMAND_CODE ("VERSION", VersionCode)
+    IRC_COMMAND_CODE ("STATS", StatsCode)
+    IRC_COMMAND_CODE ("LINKS", LinksCode)
+    IRC_COMMAND_CODE ("TIME", TimeCode)
+    IRC_COMMAND_CODE ("CONNECT", CommandCode)
+    IRC_COMMAND_CODE ("TRACE", TraceCode)
+    IRC_COMMAND_CODE ("ADMIN", AdminCode)
+    IRC_COMMAND_CODE ("INFO", InfoCode)
+    IRC_COMMAND_CODE ("SERVLIST", ServerListCode)
+    IRC_COMMAND_CODE ("SQUERY", ServerQueryCode)
+    IRC_COMMAND_CODE ("WHO", WhoCode)
+    IRC_COMMAND_CODE ("WHOIS", WhoIsCode)
+    IRC_COMMAND_CODE ("WHOWAS", WhoWasCode)
+    IRC_COMMAND_CODE ("KILL", KillCode)
+    IRC_COMMAND_CODE ("PING", PingCode)
+    IRC_COMMAND_CODE ("PONG", PongCode)
+    IRC_COMMAND_CODE ("ERROR", ErrorCode)
+    IRC_COMMAND_CODE ("AWAY", AwayCode)
+    IRC_COMMAND_CODE ("REHASH", RehashCode)
+    IRC_COMMAND_CODE ("DIE", DieCode)
+    IRC_COMMAND_CODE ("RESTART", RestartCode)
+    IRC_COMMAND_CODE ("SUMMON", SummonCode)
+    IRC_COMMAND_CODE ("USERS", UsersCode)
+    IRC_COMMAND_CODE ("OPERWALL", OperatorWallCode)
+    IRC_COMMAND_CODE ("USERHOST", UserHostCode)
+    IRC_COMMAND_CODE ("ISON", IsOnCode)
+    default:
+        return UnknownCode;
+    }
+
+#undef IRC_COMMAND_CODE
+}
+
+const char *
+name (Code code)
+{
+    // In the order of the enum.
+    static const char *const names[] = {
+        "UNKNOWN",
+        "PASS",
+        "NICK",
+        "USER",
+        "OPER",
+        "SERVICE",
+        "QUIT",
+        "SQUIT",
+        "JOIN",
+        "PART",
+        "MODE",
+        "TOPIC",
+        "NAMES",
+        "LIST",
+        "INVITE",
+        "KICK",
+        "PRIVMSG",
+        "NOTICE",
+        "MOTD",
+        "LUSERS",
+        "VERSION",
+        "STATS",
+        "LINKS",
+        "TIME",
+        "CONNECT",
+        "TRACE",
+        "ADMIN",
+        "INFO",
+        "SERVLIST",
+        "SQUERY",
+        "WHO",
+        "WHOIS",
+        "WHOWAS",
+        "KILL",
+        "PING",
+        "PONG",
+        "ERROR",
+        "AWAY",
+        "REHASH",
+        "DIE",
+        "RESTART",
+        "SUMMON",
+        "USERS",
+        "OPERWALL",
+        "USERHOST",
+        "ISON",
+    };
+    static_assert (sizeof (names) / sizeof (names[0]) == CodeCount,
+                   "every command needs a name");
+
+    return (code >= 0 && code < CodeCount) ? names[code] : names[UnknownCode];
+}
+
+}
@@ -78,4 +78,69 @@ const QString Users = "USERS";
 const QString OperatorWall = "OPERWALL";
 const QString UserHost = "USERHOST";
 const QString IsOn = "ISON";
+
+/**
+  * \enum Code
+  * Compact identifiers for the commands above. Incoming messages are
+  * classified once while parsing, so dispatching on them is a table lookup.
+  */
+enum Code {
+    UnknownCode = 0,
+    PasswordCode,
+    NickCode,
+    UserCode,
+    OperationCode,
+    ServiceCode,
+    QuitCode,
+    ServerQuitCode,
+    JoinCode,
+    PartCode,
+    ModeCode,
+    TopicCode,
+    NamesCode,
+    ListCode,
+    InviteCode,
+    KickCode,
+    PrivateMessageCode,
+    NoticeCode,
+    MessageOfTheDayCode,
+    ListUsersCode,
+    VersionCode,
+    StatsCode,
+    LinksCode,
+    TimeCode,
+    CommandCode,
+    TraceCode,
+    AdminCode,
+    InfoCode,
+    ServerListCode,
+    ServerQueryCode,
+    WhoCode,
+    WhoIsCode,
+    WhoWasCode,
+    KillCode,
+    PingCode,
+    PongCode,
+    ErrorCode,
+    AwayCode,
+    RehashCode,
+    DieCode,
+    RestartCode,
+    SummonCode,
+    UsersCode,
+    OperatorWallCode,
+    UserHostCode,
+    IsOnCode,
+    CodeCount
+};
+
+/**
+  * Classifies the command name of \a length bytes at \a data. The comparison
+  * is case-insensitive. Returns UnknownCode for anything that is not listed
+  * above.
+  */
+Code code (const char *data, int length);
+
+/** The upper case name of the command \a code stands for. */
+const char *name (Code code);
 }
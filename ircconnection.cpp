@@ -0,0 +1,292 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircconnection.h"
+#include "irctrace.h"
+
+// Qt includes
+#include <QMutexLocker>
+#include <QThread>
+
+// Standard includes
+#include <string.h>
+
+IRCConnection::IRCConnection(QObject *parent) :
+    QObject(parent),
+    m_connector(this),
+    m_sendQueue(this)
+{
+    m_sendQueue.setCapture(&m_capture);
+    m_device = 0;
+    m_tcpSocket = 0;
+    m_pongBuffer.reserve(512);
+    m_outbox.reserve(4096);
+    m_drainBuffer.reserve(4096);
+    m_parseTimer.start();
+
+    connect(&m_connector, SIGNAL(connected(QTcpSocket*, int)),
+            this, SLOT(handleConnected(QTcpSocket*, int)));
+    connect(&m_connector, SIGNAL(failed(QString)), this, SIGNAL(connectFailed(QString)));
+    connect(&m_sendQueue, SIGNAL(depthChanged(int)), this, SIGNAL(sendQueueDepthChanged(int)));
+    connect(&m_sendQueue, SIGNAL(captureFailed(QString)), this, SIGNAL(captureFailed(QString)));
+}
+
+IRCConnection::~IRCConnection()
+{
+    m_connector.abort();
+    if(m_device)
+    {
+        m_device->QObject::disconnect(this);
+        if(m_tcpSocket)
+            m_tcpSocket->abort();
+        else
+            m_device->close();
+    }
+}
+
+void
+IRCConnection::connectToHost(const QString &hostName, quint16 port)
+{
+    disconnectFromHost();
+    m_connector.connectToHost(hostName, port);
+}
+
+void
+IRCConnection::disconnectFromHost()
+{
+    m_connector.abort();
+    if(m_tcpSocket)
+    {
+        QTcpSocket *tcpSocket = m_tcpSocket;
+        tcpSocket->disconnectFromHost();
+        // The socket may still be writing, but a new connection must not
+        // wait for it.
+        if(m_tcpSocket == tcpSocket)
+            handleDisconnected();
+    }
+    else if(m_device)
+    {
+        handleDisconnected();
+    }
+}
+
+void
+IRCConnection::attachDevice(QIODevice *device)
+{
+    disconnectFromHost();
+    attach(device);
+    emit connected(QHostAddress(), 0);
+}
+
+void
+IRCConnection::startCapture(const QString &fileName)
+{
+    if(!m_capture.open(fileName))
+        emit captureFailed(QString("Could not write the capture %1: %2")
+                           .arg(fileName, m_capture.errorString()));
+}
+
+void
+IRCConnection::stopCapture()
+{
+    m_capture.close();
+}
+
+void
+IRCConnection::setMetrics(const QSharedPointer<IRCClientMetrics> &metrics)
+{
+    m_metrics = metrics;
+    m_sendQueue.setMetrics(metrics.data());
+}
+
+void
+IRCConnection::postLine(const char *line, int length, int priority)
+{
+    // Lines are kept as a priority byte followed by the line and a line
+    // feed. Like the send queue, this drops whatever follows a line break.
+    const char *lineBreak = static_cast<const char*>(memchr(line, '\n', length));
+    if(lineBreak)
+        length = lineBreak - line;
+    lineBreak = static_cast<const char*>(memchr(line, '\r', length));
+    if(lineBreak)
+        length = lineBreak - line;
+
+    bool schedule;
+    {
+        QMutexLocker locker(&m_outboxMutex);
+        schedule = m_outbox.isEmpty();
+        m_outbox.append(char(priority)).append(line, length).append('\n');
+    }
+
+    // On its own thread, the line goes to the send queue right away, so it
+    // is not overtaken by anything called directly afterwards.
+    if(thread() == QThread::currentThread())
+        drainOutbox();
+    else if(schedule)
+        QMetaObject::invokeMethod(this, "drainOutbox", Qt::QueuedConnection);
+}
+
+void
+IRCConnection::drainOutbox()
+{
+    {
+        QMutexLocker locker(&m_outboxMutex);
+        m_outbox.swap(m_drainBuffer);
+    }
+
+    const char *data = m_drainBuffer.constData();
+    const int size = m_drainBuffer.size();
+    int position = 0;
+    while(position < size)
+    {
+        const char *lineFeed = static_cast<const char*>(
+                    memchr(data + position + 1, '\n', size - position - 1));
+        const int end = lineFeed - data;
+        if(m_device)
+            m_sendQueue.enqueue(data + position + 1, end - position - 1,
+                                static_cast<IRCSendQueue::Priority>(data[position]));
+        position = end + 1;
+    }
+    m_drainBuffer.resize(0);
+}
+
+void
+IRCConnection::setFloodControl(int burst, int interval)
+{
+    m_sendQueue.setFloodControl(burst, interval);
+}
+
+void
+IRCConnection::handleConnected(QTcpSocket *socket, int milliseconds)
+{
+    m_tcpSocket = socket;
+    connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+    attach(socket);
+    emit connected(m_tcpSocket->peerAddress(), milliseconds);
+}
+
+void
+IRCConnection::attach(QIODevice *device)
+{
+    m_device = device;
+    m_device->setParent(this);
+    // Sockets announce their end with disconnected().
+    if(!m_tcpSocket)
+        connect(m_device, SIGNAL(readChannelFinished()), this, SLOT(handleDisconnected()));
+    connect(m_device, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
+    m_sendQueue.setDevice(m_device);
+}
+
+void
+IRCConnection::handleDisconnected()
+{
+    releaseSocket();
+    emit disconnected();
+}
+
+void
+IRCConnection::handleReadyRead()
+{
+    IRC_TRACE_SCOPE("IRCConnection::handleReadyRead");
+    qint64 bytes;
+    while(m_device && (bytes = m_receiveBuffer.readFrom(m_device)) > 0)
+    {
+        if(m_capture.isOpen()
+           && !m_capture.record(IRCCapture::Inbound, m_receiveBuffer.lastRead(), bytes))
+            emit captureFailed(QString("Could not write the capture %1: %2")
+                               .arg(m_capture.fileName(), m_capture.errorString()));
+
+        m_receiveBuffer.takeLines(m_receivedLines);
+        if(m_receivedLines.isEmpty())
+            continue;
+
+        // Copy all lines into one buffer the messages of the batch share,
+        // since the receive buffer is reused by the next read.
+        int size = 0;
+        for(int i = 0; i < m_receivedLines.size(); i++)
+            size += m_receivedLines.at(i).length;
+        QByteArray buffer;
+        buffer.reserve(size);
+        for(int i = 0; i < m_receivedLines.size(); i++)
+            buffer.append(m_receivedLines.at(i).data, m_receivedLines.at(i).length);
+
+        if(m_metrics)
+            m_metrics->recordReceived(m_receivedLines.size(), bytes);
+
+        IRCServerMessageBatch messages;
+        messages.reserve(m_receivedLines.size());
+        int offset = 0;
+        for(int i = 0; i < m_receivedLines.size(); i++)
+        {
+            const int length = m_receivedLines.at(i).length;
+            if(length == 0)
+                continue;
+            qint64 parseStart = m_parseTimer.nsecsElapsed();
+            IRCServerMessage message(buffer, offset, length);
+            offset += length;
+            if(m_metrics)
+            {
+                m_metrics->recordParseTime(m_parseTimer.nsecsElapsed() - parseStart);
+                if(message.isNumeric())
+                    m_metrics->recordNumeric(message.numericValue());
+                else
+                    m_metrics->recordCommand(message.commandCode());
+            }
+
+            // Answer pings without a round trip through the receiver, which
+            // may be busy.
+            if(message.commandCode() == IRCCommand::PingCode)
+            {
+                m_pongBuffer.resize(0);
+                m_pongBuffer.append("PONG :");
+                m_pongBuffer.append(message.parameter(0).toUtf8());
+                m_sendQueue.enqueue(m_pongBuffer.constData(), m_pongBuffer.size(),
+                                    IRCSendQueue::Urgent);
+                continue;
+            }
+            messages.append(message);
+        }
+
+        if(!messages.isEmpty())
+            emit messagesReceived(messages);
+    }
+}
+
+void
+IRCConnection::releaseSocket()
+{
+    m_receiveBuffer.clear();
+    m_sendQueue.clear();
+    m_sendQueue.setDevice(0);
+    if(m_tcpSocket)
+    {
+        m_tcpSocket->QObject::disconnect(this);
+        if(m_tcpSocket->state() == QAbstractSocket::UnconnectedState)
+            m_tcpSocket->deleteLater();
+        else
+            connect(m_tcpSocket, SIGNAL(disconnected()), m_tcpSocket, SLOT(deleteLater()));
+    }
+    else if(m_device)
+    {
+        m_device->QObject::disconnect(this);
+        m_device->close();
+        m_device->deleteLater();
+    }
+    m_device = 0;
+    m_tcpSocket = 0;
+}
@@ -0,0 +1,158 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircservermessage.h"
+#include "ircreceivebuffer.h"
+#include "ircsendqueue.h"
+#include "ircconnector.h"
+#include "ircclientmetrics.h"
+#include "irccapture.h"
+
+// Qt includes
+#include <QObject>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QVector>
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QMutex>
+
+/** Messages that have been received and parsed together. */
+typedef QVector<IRCServerMessage> IRCServerMessageBatch;
+
+/**
+  * \class IRCConnection
+  * The network side of a client: connects to the server, splits the
+  * incoming stream into lines, parses them and paces outgoing lines.
+  * Pings of the server are answered right here.
+  *
+  * A connection may live in a thread of its own. It is then only talked to
+  * through queued slot invocations and signals, except for outgoing lines,
+  * which are appended to a buffer of the connection under a lock. Received
+  * messages are handed over in batches, one per chunk read from the socket,
+  * all sharing a single buffer.
+  *
+  * Instead of a socket, any open device can stand in for the server, such
+  * as an IRCReplayDevice playing back a capture.
+  */
+class IRCConnection :
+        public QObject {
+    Q_OBJECT
+public:
+    IRCConnection(QObject *parent = 0);
+    ~IRCConnection();
+
+    /**
+      * Traffic and parse times are recorded into \a metrics from the thread
+      * of the connection. Set this before moving the connection.
+      */
+    void setMetrics(const QSharedPointer<IRCClientMetrics>& metrics);
+
+    /**
+      * Queues a line for sending. This may be called from any thread. The
+      * line is copied, so the caller can reuse its buffer right away; lines
+      * posted from another thread are handed to the send queue together on
+      * the next turn of the connection's event loop.
+      * \arg priority An IRCSendQueue::Priority.
+      */
+    void postLine(const char *line, int length, int priority);
+
+signals:
+    /**
+      * Sent when the connection has been established.
+      * \arg peer The address of the server.
+      * \arg milliseconds Time it took to resolve the host and connect.
+      */
+    void connected(const QHostAddress& peer, int milliseconds);
+
+    /**
+      * Sent when no connection could be established.
+      * \arg reason Description of what went wrong.
+      */
+    void connectFailed(const QString& reason);
+
+    /** Sent when an established connection has been closed. */
+    void disconnected();
+
+    /**
+      * Sent for every chunk of data received from the server.
+      * \arg messages The complete messages in that chunk.
+      */
+    void messagesReceived(const IRCServerMessageBatch& messages);
+
+    /**
+      * Sent when the number of outgoing lines waiting to be written changed.
+      * \arg depth The number of waiting lines.
+      */
+    void sendQueueDepthChanged(int depth);
+
+    /**
+      * Sent when a capture could not be started or written to. The capture
+      * is stopped then.
+      * \arg reason Description of what went wrong.
+      */
+    void captureFailed(const QString& reason);
+
+public slots:
+    void connectToHost(const QString& hostName, quint16 port);
+    void disconnectFromHost();
+
+    /**
+      * Talks to \a device, which has to be open, instead of a server. The
+      * connection takes ownership of the device.
+      */
+    void attachDevice(QIODevice *device);
+
+    /**
+      * Records everything sent and received from now on into \a fileName,
+      * continuing the capture if the file already holds one.
+      */
+    void startCapture(const QString& fileName);
+    void stopCapture();
+
+    void setFloodControl(int burst, int interval);
+
+private slots:
+    void handleConnected(QTcpSocket *socket, int milliseconds);
+    void handleDisconnected();
+    void handleReadyRead();
+    void drainOutbox();
+
+private:
+    void attach(QIODevice *device);
+    void releaseSocket();
+
+    IRCConnector                    m_connector;
+    QIODevice *                     m_device;
+    QTcpSocket *                    m_tcpSocket;
+    IRCReceiveBuffer                m_receiveBuffer;
+    QVector<IRCReceiveBuffer::Line> m_receivedLines;
+    IRCSendQueue                    m_sendQueue;
+    QByteArray                      m_pongBuffer;
+    QSharedPointer<IRCClientMetrics> m_metrics;
+    QElapsedTimer                   m_parseTimer;
+    IRCCapture                      m_capture;
+    QMutex                          m_outboxMutex;
+    QByteArray                      m_outbox;
+    QByteArray                      m_drainBuffer;
+};
+
+Q_DECLARE_METATYPE(IRCServerMessageBatch)
@@ -0,0 +1,101 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircconnectionmanager.h"
+
+IRCConnectionManager::IRCConnectionManager(int threadCount, QObject *parent) :
+    QObject(parent)
+{
+    for(int i = 0; i < threadCount; i++)
+    {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("IRC network %1").arg(i));
+        thread->start();
+        m_threads.append(thread);
+    }
+}
+
+IRCConnectionManager::~IRCConnectionManager()
+{
+    foreach(IRCClient *client, m_clients)
+        delete client;
+    m_clients.clear();
+
+    // Connections left behind by the clients are deleted when their thread
+    // finishes.
+    foreach(QThread *thread, m_threads)
+    {
+        thread->quit();
+        thread->wait();
+    }
+}
+
+IRCClient *
+IRCConnectionManager::addClient()
+{
+    IRCClient *client = new IRCClient(this);
+    QThread *thread = leastLoadedThread();
+    client->setNetworkThread(thread);
+    m_clients.append(client);
+    m_clientThreads.insert(client, thread);
+    emit clientAdded(client);
+    return client;
+}
+
+void
+IRCConnectionManager::removeClient(IRCClient *client)
+{
+    if(!m_clients.removeOne(client))
+        return;
+
+    m_clientThreads.remove(client);
+    client->disconnect();
+    emit clientRemoved(client);
+    client->deleteLater();
+}
+
+QList<IRCClient*>
+IRCConnectionManager::clients() const
+{
+    return m_clients;
+}
+
+int
+IRCConnectionManager::threadCount() const
+{
+    return m_threads.size();
+}
+
+QThread *
+IRCConnectionManager::leastLoadedThread() const
+{
+    QThread *leastLoaded = 0;
+    int leastClients = 0;
+    foreach(QThread *thread, m_threads)
+    {
+        int clients = 0;
+        foreach(QThread *clientThread, m_clientThreads)
+            clients += clientThread == thread ? 1 : 0;
+        if(!leastLoaded || clients < leastClients)
+        {
+            leastLoaded = thread;
+            leastClients = clients;
+        }
+    }
+    return leastLoaded;
+}
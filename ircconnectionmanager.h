@@ -0,0 +1,73 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircclient.h"
+
+// Qt includes
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QList>
+#include <QHash>
+
+/**
+  * \class IRCConnectionManager
+  * Owns any number of clients, each connected to a network of its own, and
+  * runs their network side on a small pool of threads. A new client is
+  * placed on the thread serving the fewest clients.
+  *
+  * Clients on the same thread share the storage sockets are read into. Atom
+  * tables stay with each client, since every network announces its own
+  * case mapping.
+  */
+class IRCConnectionManager :
+        public QObject {
+    Q_OBJECT
+public:
+    /** Number of network threads unless configured otherwise. */
+    static const int DefaultThreadCount = 2;
+
+    /**
+      * \arg threadCount Number of network threads. With 0, the network side
+      * of all clients runs in the thread of the manager.
+      */
+    IRCConnectionManager(int threadCount = DefaultThreadCount, QObject *parent = 0);
+    ~IRCConnectionManager();
+
+    /** Creates a new client. The manager keeps ownership. */
+    IRCClient *addClient();
+
+    /** Disconnects and deletes \a client. */
+    void removeClient(IRCClient *client);
+
+    QList<IRCClient*> clients() const;
+    int threadCount() const;
+
+signals:
+    void clientAdded(IRCClient *client);
+    void clientRemoved(IRCClient *client);
+
+private:
+    QThread *leastLoadedThread() const;
+
+    QVector<QThread*>           m_threads;
+    QList<IRCClient*>           m_clients;
+    QHash<IRCClient*, QThread*> m_clientThreads;
+};
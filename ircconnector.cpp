@@ -0,0 +1,172 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircconnector.h"
+
+IRCConnector::IRCConnector(QObject *parent) :
+    QObject(parent),
+    m_staggerTimer(this)
+{
+    m_port = 0;
+    m_lookupId = -1;
+    m_staggerTimer.setSingleShot(true);
+    m_staggerTimer.setInterval(StaggerInterval);
+    connect(&m_staggerTimer, SIGNAL(timeout()), this, SLOT(startNextAttempt()));
+}
+
+IRCConnector::~IRCConnector()
+{
+    abort();
+}
+
+bool
+IRCConnector::isConnecting() const
+{
+    return m_lookupId != -1 || !m_attempts.isEmpty() || !m_addresses.isEmpty();
+}
+
+void
+IRCConnector::connectToHost(const QString &hostName, quint16 port)
+{
+    abort();
+    m_hostName = hostName;
+    m_port = port;
+    m_lastError.clear();
+    m_elapsedTimer.start();
+    m_lookupId = QHostInfo::lookupHost(hostName, this, SLOT(handleLookup(QHostInfo)));
+}
+
+void
+IRCConnector::abort()
+{
+    if(m_lookupId != -1)
+    {
+        QHostInfo::abortHostLookup(m_lookupId);
+        m_lookupId = -1;
+    }
+    m_staggerTimer.stop();
+    m_addresses.clear();
+
+    foreach(QTcpSocket *attempt, m_attempts)
+    {
+        attempt->QObject::disconnect(this);
+        attempt->abort();
+        attempt->deleteLater();
+    }
+    m_attempts.clear();
+}
+
+void
+IRCConnector::handleLookup(const QHostInfo &hostInfo)
+{
+    if(hostInfo.lookupId() != m_lookupId)
+        return;
+    m_lookupId = -1;
+
+    if(hostInfo.error() != QHostInfo::NoError || hostInfo.addresses().isEmpty())
+    {
+        fail(tr("Could not resolve %1: %2").arg(m_hostName).arg(hostInfo.errorString()));
+        return;
+    }
+
+    // Alternate between the address families, starting with the family of
+    // the address the resolver prefers.
+    QList<QHostAddress> preferred;
+    QList<QHostAddress> other;
+    QAbstractSocket::NetworkLayerProtocol preferredProtocol =
+            hostInfo.addresses().first().protocol();
+    foreach(const QHostAddress &address, hostInfo.addresses())
+    {
+        if(address.protocol() == preferredProtocol)
+            preferred.append(address);
+        else
+            other.append(address);
+    }
+    while(!preferred.isEmpty() || !other.isEmpty())
+    {
+        if(!preferred.isEmpty())
+            m_addresses.append(preferred.takeFirst());
+        if(!other.isEmpty())
+            m_addresses.append(other.takeFirst());
+    }
+
+    startNextAttempt();
+}
+
+void
+IRCConnector::startNextAttempt()
+{
+    if(m_addresses.isEmpty())
+        return;
+
+    QTcpSocket *attempt = new QTcpSocket(this);
+    connect(attempt, SIGNAL(connected()), this, SLOT(handleAttemptConnected()));
+    connect(attempt, SIGNAL(error(QAbstractSocket::SocketError)),
+            this, SLOT(handleAttemptError()));
+    m_attempts.append(attempt);
+    attempt->connectToHost(m_addresses.takeFirst(), m_port);
+
+    if(!m_addresses.isEmpty())
+        m_staggerTimer.start();
+}
+
+void
+IRCConnector::handleAttemptConnected()
+{
+    QTcpSocket *winner = qobject_cast<QTcpSocket*>(sender());
+    if(!winner || !m_attempts.contains(winner))
+        return;
+
+    m_attempts.removeOne(winner);
+    winner->QObject::disconnect(this);
+    winner->setParent(0);
+    abort();
+
+    emit connected(winner, int(m_elapsedTimer.elapsed()));
+}
+
+void
+IRCConnector::handleAttemptError()
+{
+    QTcpSocket *attempt = qobject_cast<QTcpSocket*>(sender());
+    if(!attempt || !m_attempts.contains(attempt))
+        return;
+
+    m_lastError = attempt->errorString();
+    m_attempts.removeOne(attempt);
+    attempt->QObject::disconnect(this);
+    attempt->deleteLater();
+
+    // Do not wait for the stagger interval when an attempt failed already.
+    if(!m_addresses.isEmpty())
+    {
+        m_staggerTimer.stop();
+        startNextAttempt();
+    }
+    else if(m_attempts.isEmpty())
+    {
+        fail(tr("Could not connect to %1: %2").arg(m_hostName).arg(m_lastError));
+    }
+}
+
+void
+IRCConnector::fail(const QString &reason)
+{
+    abort();
+    emit failed(reason);
+}
@@ -0,0 +1,91 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QObject>
+#include <QTcpSocket>
+#include <QHostInfo>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+
+/**
+  * \class IRCConnector
+  * Establishes a TCP connection to a host name without blocking.
+  *
+  * The name is resolved asynchronously. Connection attempts are then
+  * started one after the other, alternating between IPv6 and IPv4
+  * addresses, every StaggerInterval milliseconds or as soon as the previous
+  * attempt failed. The first attempt that succeeds wins and all others are
+  * aborted, so a dead address only delays the connection a little.
+  */
+class IRCConnector :
+        public QObject {
+    Q_OBJECT
+public:
+    /** Milliseconds to wait for an attempt before starting the next one. */
+    static const int StaggerInterval = 250;
+
+    IRCConnector(QObject *parent = 0);
+    ~IRCConnector();
+
+    /** Whether a connection is being established. */
+    bool isConnecting() const;
+
+signals:
+    /**
+      * Sent when a connection has been established.
+      * \arg socket The connected socket. The receiver takes ownership.
+      * \arg milliseconds Time from the start of resolving the host name
+      * until the connection was established.
+      */
+    void connected(QTcpSocket *socket, int milliseconds);
+
+    /**
+      * Sent when no connection could be established.
+      * \arg reason Description of what went wrong.
+      */
+    void failed(const QString& reason);
+
+public slots:
+    /** Starts connecting to \a hostName, aborting any previous attempt. */
+    void connectToHost(const QString& hostName, quint16 port);
+
+    /** Aborts connecting. Neither connected() nor failed() will be sent. */
+    void abort();
+
+private slots:
+    void handleLookup(const QHostInfo& hostInfo);
+    void startNextAttempt();
+    void handleAttemptConnected();
+    void handleAttemptError();
+
+private:
+    void fail(const QString& reason);
+
+    QList<QHostAddress>     m_addresses;
+    QList<QTcpSocket*>      m_attempts;
+    QString                 m_hostName;
+    quint16                 m_port;
+    int                     m_lookupId;
+    QString                 m_lastError;
+    QTimer                  m_staggerTimer;
+    QElapsedTimer           m_elapsedTimer;
+};
@@ -0,0 +1,86 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "irclagstatistics.h"
+
+// Standard includes
+#include <algorithm>
+
+IRCLagStatistics::IRCLagStatistics()
+{
+    m_samples.reserve(SampleCount);
+    m_next = 0;
+}
+
+void
+IRCLagStatistics::addSample(int milliseconds)
+{
+    if(m_samples.size() < SampleCount)
+        m_samples.append(milliseconds);
+    else
+        m_samples[m_next] = milliseconds;
+    m_next = (m_next + 1) % SampleCount;
+}
+
+void
+IRCLagStatistics::clear()
+{
+    m_samples.clear();
+    m_next = 0;
+}
+
+int
+IRCLagStatistics::count() const
+{
+    return m_samples.size();
+}
+
+int
+IRCLagStatistics::last() const
+{
+    if(m_samples.isEmpty())
+        return -1;
+    return m_samples.at((m_next + SampleCount - 1) % SampleCount);
+}
+
+int
+IRCLagStatistics::percentile(int percent) const
+{
+    if(m_samples.isEmpty())
+        return -1;
+
+    // Nearest rank, so that the result is always one of the samples.
+    QVector<int> samples = m_samples;
+    int rank = qBound(0, (percent * samples.size() + 99) / 100 - 1, samples.size() - 1);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples.at(rank);
+}
+
+int
+IRCLagStatistics::median() const
+{
+    return percentile(50);
+}
+
+int
+IRCLagStatistics::maximum() const
+{
+    if(m_samples.isEmpty())
+        return -1;
+    return *std::max_element(m_samples.begin(), m_samples.end());
+}
@@ -0,0 +1,56 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QVector>
+
+/**
+  * \class IRCLagStatistics
+  * Keeps the most recent round trip times of a connection and summarizes
+  * them. Older samples are forgotten, so the figures follow the current
+  * state of the connection.
+  */
+class IRCLagStatistics {
+public:
+    /** Number of samples the figures are computed from. */
+    static const int SampleCount = 128;
+
+    IRCLagStatistics();
+
+    void addSample(int milliseconds);
+    void clear();
+
+    /** Number of samples currently kept. */
+    int count() const;
+
+    /** The most recent sample, or -1 if there is none. */
+    int last() const;
+
+    /**
+    * Returns the round trip time that \a percent of the samples do not
+    * exceed, or -1 if there are no samples.
+    */
+    int percentile(int percent) const;
+    int median() const;
+    int maximum() const;
+
+private:
+    QVector<int> m_samples;
+    int          m_next;
+};
@@ -0,0 +1,109 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircmessagedelegate.h"
+#include "ircmessagemodel.h"
+
+// Qt includes
+#include <QPainter>
+#include <QFontMetrics>
+
+IRCMessageDelegate::IRCMessageDelegate(QObject *parent) :
+    QStyledItemDelegate(parent),
+    m_layouts(LayoutCacheSize)
+{
+}
+
+void
+IRCMessageDelegate::paint(QPainter *painter,
+                          const QStyleOptionViewItem &option,
+                          const QModelIndex &index) const
+{
+    painter->save();
+    if(option.state & QStyle::State_Selected)
+        painter->fillRect(option.rect, option.palette.highlight());
+    painter->setClipRect(option.rect);
+    layout(option, index)->draw(painter, option.rect.topLeft());
+    painter->restore();
+}
+
+QSize
+IRCMessageDelegate::sizeHint(const QStyleOptionViewItem &option,
+                             const QModelIndex &index) const
+{
+    Q_UNUSED(index);
+    // All rows are a single line high, which lets the view use uniform
+    // item sizes and never measure rows it does not show.
+    return QSize(option.rect.width(), QFontMetrics(option.font).height());
+}
+
+void
+IRCMessageDelegate::clearCache()
+{
+    m_layouts.clear();
+}
+
+QTextLayout *
+IRCMessageDelegate::layout(const QStyleOptionViewItem &option,
+                           const QModelIndex &index) const
+{
+    if(m_font != option.font)
+    {
+        m_layouts.clear();
+        m_font = option.font;
+    }
+
+    qint64 messageId = index.data(IRCMessageModel::MessageIdRole).toLongLong();
+    QTextLayout *textLayout = m_layouts.object(messageId);
+    if(textLayout)
+        return textLayout;
+
+    QString nick = index.data(IRCMessageModel::NickRole).toString();
+    QString text = nick + ": " + index.data(IRCMessageModel::MessageRole).toString();
+    QBrush brush = qvariant_cast<QBrush>(index.data(Qt::ForegroundRole));
+
+    QTextLayout::FormatRange nickRange;
+    nickRange.start = 0;
+    nickRange.length = nick.size();
+    nickRange.format.setForeground(brush);
+    nickRange.format.setFontWeight(QFont::Bold);
+
+    QTextLayout::FormatRange messageRange;
+    messageRange.start = nick.size();
+    messageRange.length = text.size() - nick.size();
+    messageRange.format.setForeground(brush);
+
+    QList<QTextLayout::FormatRange> formats;
+    formats << nickRange << messageRange;
+
+    QTextOption textOption;
+    textOption.setWrapMode(QTextOption::NoWrap);
+
+    textLayout = new QTextLayout(text, option.font);
+    textLayout->setTextOption(textOption);
+    textLayout->setAdditionalFormats(formats);
+    textLayout->setCacheEnabled(true);
+    textLayout->beginLayout();
+    QTextLine line = textLayout->createLine();
+    if(line.isValid())
+        line.setLineWidth(option.rect.width());
+    textLayout->endLayout();
+
+    m_layouts.insert(messageId, textLayout);
+    return textLayout;
+}
@@ -0,0 +1,58 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QStyledItemDelegate>
+#include <QTextLayout>
+#include <QCache>
+#include <QFont>
+
+/**
+  * \class IRCMessageDelegate
+  * Draws the rows of an IRCMessageModel as single lines of text with the nick
+  * highlighted. Views only ask for the rows that are visible; the text
+  * layouts of those rows are cached by message id, so repainting while
+  * scrolling does not shape the same text again, and rows that move when
+  * older messages are removed keep their layouts.
+  */
+class IRCMessageDelegate :
+        public QStyledItemDelegate {
+    Q_OBJECT
+public:
+    /** Number of row layouts that are kept cached. */
+    static const int LayoutCacheSize = 1024;
+
+    IRCMessageDelegate(QObject *parent = 0);
+
+    void paint(QPainter *painter,
+               const QStyleOptionViewItem &option,
+               const QModelIndex &index) const;
+    QSize sizeHint(const QStyleOptionViewItem &option,
+                   const QModelIndex &index) const;
+
+    /** Drops all cached layouts. */
+    void clearCache();
+
+private:
+    QTextLayout *layout(const QStyleOptionViewItem &option,
+                        const QModelIndex &index) const;
+
+    mutable QCache<qint64, QTextLayout> m_layouts;
+    mutable QFont                       m_font;
+};
@@ -0,0 +1,230 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircmessagemodel.h"
+
+// Qt includes
+#include <QDateTime>
+
+// Standard includes
+#include <string.h>
+
+IRCMessageModel::IRCMessageModel(IRCAtomTable *atomTable,
+                                 IRCNickFormatCache *nickFormatCache,
+                                 QObject *parent) :
+    QAbstractListModel(parent)
+{
+    m_atomTable = atomTable;
+    m_nickFormatCache = nickFormatCache;
+    m_firstEntry = 0;
+    m_entryBase = 0;
+    m_textBase = 0;
+    m_publishedRows = 0;
+}
+
+int
+IRCMessageModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+        return 0;
+    return m_publishedRows;
+}
+
+QVariant
+IRCMessageModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= m_publishedRows)
+        return QVariant();
+
+    const Entry &entry = this->entry(index.row());
+    switch(role)
+    {
+    case Qt::DisplayRole:
+        return m_atomTable->name(entry.nickAtom) + ": " + message(index.row());
+    case Qt::ForegroundRole:
+        return m_nickFormatCache->format(entry.nickAtom).foreground();
+    case NickRole:
+        return m_atomTable->name(entry.nickAtom);
+    case NickAtomRole:
+        return entry.nickAtom;
+    case MessageRole:
+        return message(index.row());
+    case TimestampRole:
+        return QDateTime::fromMSecsSinceEpoch(entry.timestamp);
+    case MessageIdRole:
+        return messageId(index.row());
+    default:
+        return QVariant();
+    }
+}
+
+void
+IRCMessageModel::appendMessage(qint64 timestamp, int nickAtom, const QString &message,
+                               qint64 record)
+{
+    Entry entry;
+    entry.timestamp = timestamp;
+    entry.nickAtom = nickAtom;
+    entry.textOffset = m_textBase + m_text.size();
+    entry.record = record;
+    m_entries.append(entry);
+    m_text.append(message.toUtf8());
+}
+
+void
+IRCMessageModel::publish()
+{
+    if(m_publishedRows == messageCount())
+        return;
+
+    beginInsertRows(QModelIndex(), m_publishedRows, messageCount() - 1);
+    m_publishedRows = messageCount();
+    endInsertRows();
+}
+
+void
+IRCMessageModel::prependRecords(qint64 firstRecord, const QVector<IRCChannelLog::Record> &records)
+{
+    if(records.isEmpty())
+        return;
+
+    QVector<QByteArray> texts(records.size());
+    int textBytes = 0;
+    for(int i = 0; i < records.size(); i++)
+    {
+        texts[i] = records.at(i).payload.toUtf8();
+        textBytes += texts.at(i).size();
+    }
+    reserveFront(records.size(), textBytes);
+
+    beginInsertRows(QModelIndex(), 0, records.size() - 1);
+    qint64 textOffset = firstTextOffset();
+    for(int i = records.size() - 1; i >= 0; i--)
+    {
+        const QByteArray &text = texts.at(i);
+        textOffset -= text.size();
+        memcpy(m_text.data() + (textOffset - m_textBase), text.constData(), text.size());
+
+        Entry &entry = m_entries[--m_firstEntry];
+        entry.timestamp = records.at(i).timestamp;
+        entry.nickAtom = m_atomTable->intern(records.at(i).sender);
+        entry.textOffset = textOffset;
+        entry.record = firstRecord + i;
+    }
+    m_publishedRows += records.size();
+    endInsertRows();
+}
+
+QString
+IRCMessageModel::message(int row) const
+{
+    qint64 begin = entry(row).textOffset - m_textBase;
+    qint64 end = (row + 1 < messageCount()) ? entry(row + 1).textOffset - m_textBase
+                                            : m_text.size();
+    return QString::fromUtf8(m_text.constData() + begin, int(end - begin));
+}
+
+qint64
+IRCMessageModel::messageId(int row) const
+{
+    return m_entryBase + m_firstEntry + row;
+}
+
+qint64
+IRCMessageModel::record(int row) const
+{
+    return entry(row).record;
+}
+
+int
+IRCMessageModel::messageCount() const
+{
+    return m_entries.size() - m_firstEntry;
+}
+
+void
+IRCMessageModel::removeFirstMessages(int count)
+{
+    count = qMin(count, messageCount());
+    if(count <= 0)
+        return;
+
+    int publishedCount = qMin(count, m_publishedRows);
+    if(publishedCount > 0)
+        beginRemoveRows(QModelIndex(), 0, publishedCount - 1);
+    m_firstEntry += count;
+    m_publishedRows -= publishedCount;
+    compact();
+    if(publishedCount > 0)
+        endRemoveRows();
+}
+
+const IRCMessageModel::Entry &
+IRCMessageModel::entry(int row) const
+{
+    return m_entries.at(m_firstEntry + row);
+}
+
+qint64
+IRCMessageModel::firstTextOffset() const
+{
+    return m_firstEntry < m_entries.size() ? m_entries.at(m_firstEntry).textOffset
+                                           : m_textBase + m_text.size();
+}
+
+void
+IRCMessageModel::reserveFront(int entries, int textBytes)
+{
+    // The room added in front grows with the model, so that paging in a
+    // long history one page at a time moves every message only a few times.
+    if(m_firstEntry < entries)
+    {
+        int room = qMax(entries, messageCount());
+        m_entries.insert(0, room, Entry());
+        m_firstEntry += room;
+        m_entryBase -= room;
+    }
+
+    qint64 unused = firstTextOffset() - m_textBase;
+    if(unused < textBytes)
+    {
+        int room = int(qMax<qint64>(textBytes, m_textBase + m_text.size() - firstTextOffset()));
+        m_text.prepend(QByteArray(room, '\0'));
+        m_textBase -= room;
+    }
+}
+
+void
+IRCMessageModel::compact()
+{
+    // Moving the remaining messages only once the removed ones take up half
+    // of the storage keeps removing from the front linear over time.
+    if(m_firstEntry > 0 && m_firstEntry >= m_entries.size() / 2)
+    {
+        m_entries.remove(0, m_firstEntry);
+        m_entryBase += m_firstEntry;
+        m_firstEntry = 0;
+    }
+
+    qint64 unused = firstTextOffset() - m_textBase;
+    if(unused > 0 && unused >= m_text.size() / 2)
+    {
+        m_text.remove(0, int(unused));
+        m_textBase += unused;
+    }
+}
@@ -0,0 +1,128 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircatomtable.h"
+#include "ircchannellog.h"
+#include "ircnickformatcache.h"
+
+// Qt includes
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QVector>
+
+/**
+  * \class IRCMessageModel
+  * Compact store of the messages of a channel, exposed as a list model.
+  * Every message takes a fixed size entry holding its timestamp, the atom
+  * id of the sender and the offset of its text in a shared UTF-8 buffer.
+  * Messages are added in batches: appended messages become visible to
+  * views with the next call to publish(). The oldest messages are removed
+  * with removeFirstMessages(); their space is reclaimed once it makes up
+  * half of the storage, so the model stays as small as the rows it holds.
+  * Older messages are put back in front from the log of the channel with
+  * prependRecords(), which leaves room for further pages in front.
+  */
+class IRCMessageModel :
+        public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        NickRole = Qt::UserRole + 1,
+        NickAtomRole,
+        MessageRole,
+        TimestampRole,
+        /** Identifies a message for as long as the model holds it, see messageId(). */
+        MessageIdRole
+    };
+
+    IRCMessageModel(IRCAtomTable *atomTable,
+                    IRCNickFormatCache *nickFormatCache,
+                    QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    /**
+      * Appends a message.
+      * \arg timestamp Milliseconds since the epoch the message arrived at.
+      * \arg nickAtom Atom id of the sender.
+      * \arg message The text of the message.
+      * \arg record Number of the message in the log of the channel, or -1
+      * if it has not been logged.
+      */
+    void appendMessage(qint64 timestamp, int nickAtom, const QString& message,
+                       qint64 record);
+
+    /** Makes all appended messages visible, as a single row insertion. */
+    void publish();
+
+    /**
+      * Inserts log records in front of all messages, as a single row
+      * insertion.
+      * \arg firstRecord Number of the first of \a records in the log.
+      * \arg records Consecutive records, oldest first.
+      */
+    void prependRecords(qint64 firstRecord, const QVector<IRCChannelLog::Record>& records);
+
+    /** Returns the text of the message in \a row. */
+    QString message(int row) const;
+
+    /**
+      * Returns an id of the message in \a row that stays the same while
+      * rows are removed in front of it, unlike the row itself.
+      */
+    qint64 messageId(int row) const;
+
+    /** Returns the log record number of the message in \a row, or -1. */
+    qint64 record(int row) const;
+
+    /** Number of messages held, including those not published yet. */
+    int messageCount() const;
+
+    /** Removes the \a count oldest messages. */
+    void removeFirstMessages(int count);
+
+private:
+    struct Entry {
+        qint64  timestamp;
+        qint32  nickAtom;
+        /**
+          * Offset of the text, counted from the first text ever appended.
+          * Texts put in front of that are at negative offsets.
+          */
+        qint64  textOffset;
+        qint64  record;
+    };
+
+    const Entry& entry(int row) const;
+    qint64 firstTextOffset() const;
+    void reserveFront(int entries, int textBytes);
+    void compact();
+
+    IRCAtomTable *          m_atomTable;
+    IRCNickFormatCache *    m_nickFormatCache;
+    QVector<Entry>          m_entries;
+    int                     m_firstEntry;
+    /** Id of the message in the first entry of m_entries. */
+    qint64                  m_entryBase;
+    QByteArray              m_text;
+    qint64                  m_textBase;
+    int                     m_publishedRows;
+};
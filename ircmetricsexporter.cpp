@@ -0,0 +1,240 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircmetricsexporter.h"
+
+// Qt includes
+#include <QSaveFile>
+#include <QLocalSocket>
+
+namespace {
+
+QString
+escapeLabel(QString value)
+{
+    return value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+}
+
+void
+appendHeader(QByteArray &text, const char *name, const char *type, const char *help)
+{
+    text.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    text.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+void
+appendSample(QByteArray &text, const char *name, const QString &labels, quint64 value)
+{
+    text.append(name).append('{').append(labels.toUtf8()).append("} ");
+    text.append(QByteArray::number(value)).append('\n');
+}
+
+/** Histograms of nanoseconds are published in seconds, as is customary. */
+void
+appendHistogram(QByteArray &text, const char *name, const QString &labels,
+                const IRCMetricsHistogram::Snapshot &histogram)
+{
+    QByteArray prefix = QByteArray(name).append("_bucket{").append(labels.toUtf8());
+    quint64 cumulative = 0;
+    for(int i = 0; i < IRCMetricsHistogram::BucketCount - 1; i++)
+    {
+        cumulative += histogram.buckets.at(i);
+        text.append(prefix).append(",le=\"");
+        text.append(QByteArray::number(double(quint64(1) << i) / 1e9, 'g', 6));
+        text.append("\"} ").append(QByteArray::number(cumulative)).append('\n');
+    }
+    text.append(prefix).append(",le=\"+Inf\"} ");
+    text.append(QByteArray::number(histogram.count)).append('\n');
+
+    text.append(name).append("_sum{").append(labels.toUtf8()).append("} ");
+    text.append(QByteArray::number(double(histogram.sum) / 1e9, 'g', 9)).append('\n');
+    text.append(name).append("_count{").append(labels.toUtf8()).append("} ");
+    text.append(QByteArray::number(histogram.count)).append('\n');
+}
+
+}
+
+IRCMetricsExporter::IRCMetricsExporter(QObject *parent) :
+    QObject(parent),
+    m_fileTimer(this),
+    m_localServer(this)
+{
+    connect(&m_fileTimer, SIGNAL(timeout()), this, SLOT(writeFile()));
+    connect(&m_localServer, SIGNAL(newConnection()), this, SLOT(handleNewConnection()));
+}
+
+void
+IRCMetricsExporter::addClient(IRCClient *client)
+{
+    if(m_clients.contains(client))
+        return;
+    m_clients.append(client);
+    connect(client, SIGNAL(destroyed(QObject*)), this, SLOT(handleClientDestroyed(QObject*)));
+}
+
+void
+IRCMetricsExporter::removeClient(IRCClient *client)
+{
+    if(m_clients.removeAll(client))
+        client->QObject::disconnect(this);
+}
+
+bool
+IRCMetricsExporter::writeToFile(const QString &fileName, int interval)
+{
+    m_fileName = fileName;
+    m_fileTimer.start(interval);
+    return writeFile();
+}
+
+bool
+IRCMetricsExporter::listen(const QString &name)
+{
+    m_localServer.close();
+    // A socket left behind by a crashed process would block the name.
+    QLocalServer::removeServer(name);
+    return m_localServer.listen(name);
+}
+
+void
+IRCMetricsExporter::close()
+{
+    m_fileTimer.stop();
+    m_fileName.clear();
+    m_localServer.close();
+}
+
+QByteArray
+IRCMetricsExporter::prometheusText(const QList<IRCClient*> &clients)
+{
+    QList<QString> labels;
+    QList<IRCClientMetrics::Snapshot> snapshots;
+    for(int i = 0; i < clients.size(); i++)
+    {
+        labels.append(QString("server=\"%1\",client=\"%2\"")
+                      .arg(escapeLabel(clients.at(i)->hostName())).arg(i));
+        snapshots.append(clients.at(i)->metrics()->snapshot());
+    }
+
+    QByteArray text;
+
+    appendHeader(text, "qtirc_lines_received_total", "counter", "Lines received from the server.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_lines_received_total", labels.at(i), snapshots.at(i).linesReceived);
+
+    appendHeader(text, "qtirc_bytes_received_total", "counter", "Bytes received from the server.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_bytes_received_total", labels.at(i), snapshots.at(i).bytesReceived);
+
+    appendHeader(text, "qtirc_lines_sent_total", "counter", "Lines written to the server.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_lines_sent_total", labels.at(i), snapshots.at(i).linesSent);
+
+    appendHeader(text, "qtirc_bytes_sent_total", "counter", "Bytes written to the server.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_bytes_sent_total", labels.at(i), snapshots.at(i).bytesSent);
+
+    appendHeader(text, "qtirc_messages_received_total", "counter",
+                 "Messages received, by command or numeric reply.");
+    for(int i = 0; i < snapshots.size(); i++)
+    {
+        const IRCClientMetrics::Snapshot &snapshot = snapshots.at(i);
+        for(int code = 0; code < snapshot.commandCounts.size(); code++)
+        {
+            if(snapshot.commandCounts.at(code))
+            {
+                QString command = IRCCommand::name(static_cast<IRCCommand::Code>(code));
+                appendSample(text, "qtirc_messages_received_total",
+                             labels.at(i) + QString(",command=\"%1\"").arg(command),
+                             snapshot.commandCounts.at(code));
+            }
+        }
+        for(int numeric = 0; numeric < snapshot.numericCounts.size(); numeric++)
+        {
+            if(snapshot.numericCounts.at(numeric))
+            {
+                appendSample(text, "qtirc_messages_received_total",
+                             labels.at(i) + QString(",command=\"%1\"").arg(numeric, 3, 10, QChar('0')),
+                             snapshot.numericCounts.at(numeric));
+            }
+        }
+    }
+
+    appendHeader(text, "qtirc_send_queue_depth", "gauge", "Lines waiting to be written.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_send_queue_depth", labels.at(i), snapshots.at(i).sendQueueDepth);
+
+    appendHeader(text, "qtirc_send_queue_depth_max", "gauge", "Most lines ever waiting to be written.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendSample(text, "qtirc_send_queue_depth_max", labels.at(i), snapshots.at(i).maximumSendQueueDepth);
+
+    appendHeader(text, "qtirc_parse_seconds", "histogram", "Time spent parsing a message.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendHistogram(text, "qtirc_parse_seconds", labels.at(i), snapshots.at(i).parseTime);
+
+    appendHeader(text, "qtirc_dispatch_seconds", "histogram", "Time spent handling a message.");
+    for(int i = 0; i < snapshots.size(); i++)
+        appendHistogram(text, "qtirc_dispatch_seconds", labels.at(i), snapshots.at(i).dispatchTime);
+
+    appendHeader(text, "qtirc_render_seconds", "histogram",
+                 "Time spent displaying a batch of messages of a channel.");
+    for(int i = 0; i < snapshots.size(); i++)
+    {
+        const IRCClientMetrics::Snapshot &snapshot = snapshots.at(i);
+        QHash<QString, IRCMetricsHistogram::Snapshot>::const_iterator channel;
+        for(channel = snapshot.renderTime.constBegin(); channel != snapshot.renderTime.constEnd(); ++channel)
+        {
+            appendHistogram(text, "qtirc_render_seconds",
+                            labels.at(i) + QString(",channel=\"%1\"").arg(escapeLabel(channel.key())),
+                            channel.value());
+        }
+    }
+
+    return text;
+}
+
+bool
+IRCMetricsExporter::writeFile()
+{
+    if(m_fileName.isEmpty())
+        return false;
+
+    QSaveFile file(m_fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(prometheusText(m_clients));
+    return file.commit();
+}
+
+void
+IRCMetricsExporter::handleNewConnection()
+{
+    while(QLocalSocket *socket = m_localServer.nextPendingConnection())
+    {
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+        socket->write(prometheusText(m_clients));
+        // Closes once everything has been written.
+        socket->disconnectFromServer();
+    }
+}
+
+void
+IRCMetricsExporter::handleClientDestroyed(QObject *client)
+{
+    m_clients.removeAll(static_cast<IRCClient*>(client));
+}
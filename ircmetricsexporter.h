@@ -0,0 +1,83 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircclient.h"
+
+// Qt includes
+#include <QObject>
+#include <QList>
+#include <QTimer>
+#include <QLocalServer>
+
+/**
+  * \class IRCMetricsExporter
+  * Publishes the metrics of a set of clients in the Prometheus text format,
+  * either by rewriting a file periodically, as picked up by the textfile
+  * collector of node_exporter, or on a local socket that answers every
+  * connection with the current figures.
+  */
+class IRCMetricsExporter :
+        public QObject {
+    Q_OBJECT
+public:
+    /** Milliseconds between two updates of the file unless given otherwise. */
+    static const int DefaultInterval = 10 * 1000;
+
+    IRCMetricsExporter(QObject *parent = 0);
+
+    /** Includes \a client until it is removed or deleted. */
+    void addClient(IRCClient *client);
+    void removeClient(IRCClient *client);
+
+    /**
+      * Rewrites \a fileName every \a interval milliseconds. The file is
+      * replaced as a whole, so readers never see a partial update.
+      * \return Whether the first write succeeded.
+      */
+    bool writeToFile(const QString& fileName, int interval = DefaultInterval);
+
+    /**
+      * Listens on the local socket \a name, a Unix domain socket on most
+      * systems.
+      * \return Whether the socket could be created.
+      */
+    bool listen(const QString& name);
+
+    /** Stops writing the file and closes the socket. */
+    void close();
+
+    /**
+      * The metrics of \a clients in the Prometheus text format. Series are
+      * labelled with the server and the position of the client in
+      * \a clients, so several connections to one server stay apart.
+      */
+    static QByteArray prometheusText(const QList<IRCClient*>& clients);
+
+private slots:
+    bool writeFile();
+    void handleNewConnection();
+    void handleClientDestroyed(QObject *client);
+
+private:
+    QList<IRCClient*> m_clients;
+    QString           m_fileName;
+    QTimer            m_fileTimer;
+    QLocalServer      m_localServer;
+};
@@ -0,0 +1,75 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircnickformatcache.h"
+#include "ircclient.h"
+
+IRCNickFormatCache *
+IRCNickFormatCache::forClient(IRCClient *ircClient)
+{
+    IRCNickFormatCache *cache =
+            ircClient->findChild<IRCNickFormatCache*>(QString(), Qt::FindDirectChildrenOnly);
+    if(!cache)
+        cache = new IRCNickFormatCache(ircClient->atomTable(), ircClient);
+    return cache;
+}
+
+IRCNickFormatCache::IRCNickFormatCache(IRCAtomTable *atomTable, QObject *parent) :
+    QObject(parent)
+{
+    m_atomTable = atomTable;
+    m_caseMapping = atomTable->caseMapping();
+}
+
+const QTextCharFormat&
+IRCNickFormatCache::format(int nickAtom)
+{
+    // Nicks that are the same under the new case mapping share a color.
+    if(m_atomTable->caseMapping() != m_caseMapping)
+    {
+        m_caseMapping = m_atomTable->caseMapping();
+        clear();
+    }
+
+    QHash<int, QTextCharFormat>::iterator it = m_formats.find(nickAtom);
+    if(it == m_formats.end())
+    {
+        QTextCharFormat format;
+        format.setForeground(color(m_atomTable->name(nickAtom)));
+        format.setFontWeight(QFont::Bold);
+        it = m_formats.insert(nickAtom, format);
+    }
+    return it.value();
+}
+
+QColor
+IRCNickFormatCache::color(const QString &nick) const
+{
+    // FNV-1a over the folded nick, spread over the color wheel.
+    QString folded = m_atomTable->fold(nick);
+    quint32 hash = 2166136261u;
+    for(int i = 0; i < folded.size(); i++)
+        hash = (hash ^ folded.at(i).unicode()) * 16777619u;
+    return QColor::fromHsv(hash % 360, 255, 128);
+}
+
+void
+IRCNickFormatCache::clear()
+{
+    m_formats.clear();
+}
@@ -0,0 +1,60 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircatomtable.h"
+class IRCClient;
+
+// Qt includes
+#include <QObject>
+#include <QHash>
+#include <QColor>
+#include <QTextCharFormat>
+
+/**
+  * \class IRCNickFormatCache
+  * Hands out the character format nicks are rendered with. The color of a
+  * nick is derived from a hash of its folded name, so it does not depend on
+  * who else is in a channel and stays the same in every channel. Formats are
+  * built once per nick and looked up by atom id afterwards. They are built
+  * anew when the case mapping of the atom table changes.
+  */
+class IRCNickFormatCache :
+        public QObject {
+    Q_OBJECT
+public:
+    /** Returns the cache for the nicks of \a ircClient, creating it on first use. */
+    static IRCNickFormatCache *forClient(IRCClient *ircClient);
+
+    IRCNickFormatCache(IRCAtomTable *atomTable, QObject *parent = 0);
+
+    /** Returns the format for the nick with \a nickAtom. */
+    const QTextCharFormat& format(int nickAtom);
+
+    /** Returns the color for \a nick. */
+    QColor color(const QString& nick) const;
+
+    /** Drops all cached formats, for example after the case mapping changed. */
+    void clear();
+
+private:
+    IRCAtomTable *                  m_atomTable;
+    IRCAtomTable::CaseMapping       m_caseMapping;
+    QHash<int, QTextCharFormat>     m_formats;
+};
@@ -0,0 +1,148 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircreceivebuffer.h"
+
+// Qt includes
+#include <QThreadStorage>
+
+// Standard includes
+#include <string.h>
+
+IRCReceiveBuffer::IRCReceiveBuffer()
+{
+    m_data = 0;
+    m_begin = 0;
+    m_end = 0;
+    m_lastRead = 0;
+    m_discarding = false;
+}
+
+qint64
+IRCReceiveBuffer::readFrom(QIODevice *device)
+{
+    // Continue the incomplete line we carry over at the front of the storage,
+    // so the next read can use the rest.
+    QByteArray &storage = sharedStorage();
+    int carried = m_incompleteLine.size();
+    if(carried >= storage.size())
+    {
+        if(storage.size() < MaximumCapacity)
+            storage.resize(qMin(MaximumCapacity, storage.size() * 2));
+        if(carried >= storage.size())
+        {
+            // The storage would be filled with a single incomplete line. Its
+            // tail must not be taken for a line of its own, so it is skipped
+            // as well.
+            m_incompleteLine.clear();
+            carried = 0;
+            m_discarding = true;
+        }
+    }
+    memcpy(storage.data(), m_incompleteLine.constData(), carried);
+
+    qint64 bytesRead = device->read(storage.data() + carried,
+                                    storage.size() - carried);
+    m_data = storage.constData();
+    m_begin = 0;
+    m_end = 0;
+    if(bytesRead <= 0)
+        return 0;
+
+    m_incompleteLine.resize(0);
+    m_lastRead = carried;
+    m_end = carried + bytesRead;
+    return bytesRead;
+}
+
+int
+IRCReceiveBuffer::takeLines(QVector<Line> &lines)
+{
+    lines.resize(0);
+    if(!m_data)
+        return 0;
+
+    if(m_discarding)
+    {
+        const char *terminator = static_cast<const char*>(
+                    memchr(m_data + m_begin, '\n', m_end - m_begin));
+        if(!terminator)
+        {
+            m_begin = m_end = 0;
+            return 0;
+        }
+        m_begin = terminator - m_data + 1;
+        m_discarding = false;
+    }
+
+    while(m_begin < m_end)
+    {
+        // memchr is vectorized by the C library, which makes it the fastest
+        // portable way of finding the line terminators.
+        const char *terminator = static_cast<const char*>(
+                    memchr(m_data + m_begin, '\n', m_end - m_begin));
+        if(!terminator)
+            break;
+
+        Line line;
+        line.data = m_data + m_begin;
+        line.length = terminator - line.data;
+        if(line.length > 0 && line.data[line.length - 1] == '\r')
+            line.length--;
+        if(line.length > 0)
+            lines.append(line);
+        m_begin = terminator - m_data + 1;
+    }
+
+    // Keep what is left of the storage, which the next read may overwrite.
+    if(m_begin < m_end)
+        m_incompleteLine = QByteArray(m_data + m_begin, m_end - m_begin);
+    m_begin = m_end = 0;
+    return lines.size();
+}
+
+const char *
+IRCReceiveBuffer::lastRead() const
+{
+    return m_data + m_lastRead;
+}
+
+int
+IRCReceiveBuffer::pendingBytes() const
+{
+    return m_incompleteLine.size() + m_end - m_begin;
+}
+
+void
+IRCReceiveBuffer::clear()
+{
+    m_incompleteLine.clear();
+    m_data = 0;
+    m_begin = 0;
+    m_end = 0;
+    m_discarding = false;
+}
+
+QByteArray &
+IRCReceiveBuffer::sharedStorage()
+{
+    static QThreadStorage<QByteArray> storage;
+    if(!storage.hasLocalData())
+        storage.setLocalData(QByteArray(InitialCapacity, Qt::Uninitialized));
+    return storage.localData();
+}
@@ -0,0 +1,89 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QByteArray>
+#include <QIODevice>
+#include <QVector>
+
+/**
+  * \class IRCReceiveBuffer
+  * Receive buffer for a single connection. The socket is drained in large
+  * reads into storage that all receive buffers of a thread share, since
+  * they are used one after the other anyway. Complete lines are handed out
+  * as views into that storage, so no memory is allocated per line. An
+  * incomplete line at the end of a read is kept by the buffer itself and
+  * completed by the next read, so an idle connection holds no storage.
+  */
+class IRCReceiveBuffer {
+public:
+    /** A view of a single line, without its line terminator. */
+    struct Line {
+        const char *data;
+        int         length;
+    };
+
+    /** Storage the shared storage of a thread starts with. */
+    static const int InitialCapacity = 64 * 1024;
+
+    /**
+      * Storage the shared storage may grow to while waiting for the end of
+      * a line. A line longer than this is discarded as a whole, everything
+      * up to its line terminator is skipped.
+      */
+    static const int MaximumCapacity = 1024 * 1024;
+
+    IRCReceiveBuffer();
+
+    /**
+      * Reads as much as fits from \a device in a single read. All views
+      * handed out before, by any receive buffer of the calling thread, are
+      * invalid afterwards. Lines have to be taken before another receive
+      * buffer of the same thread reads.
+      * \return The number of bytes read, 0 if nothing was available.
+      */
+    qint64 readFrom(QIODevice *device);
+
+    /**
+      * Collects all complete lines that have been received into \a lines,
+      * replacing its previous contents. Empty lines are skipped.
+      * \return The number of lines collected.
+      */
+    int takeLines(QVector<Line>& lines);
+
+    /** The bytes added by the last readFrom(), valid until takeLines(). */
+    const char *lastRead() const;
+
+    /** Number of bytes received that do not form a complete line yet. */
+    int pendingBytes() const;
+
+    /** Discards everything that has been received. */
+    void clear();
+
+private:
+    static QByteArray& sharedStorage();
+
+    QByteArray  m_incompleteLine;
+    const char *m_data;
+    int         m_begin;
+    int         m_end;
+    int         m_lastRead;
+    /** Whether the rest of a line that was too long is being skipped. */
+    bool        m_discarding;
+};
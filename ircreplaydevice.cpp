@@ -0,0 +1,153 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircreplaydevice.h"
+
+// Standard includes
+#include <string.h>
+
+IRCReplayDevice::IRCReplayDevice(const QString &fileName, Speed speed, QObject *parent) :
+    QIODevice(parent),
+    m_replayTimer(this)
+{
+    m_fileName = fileName;
+    m_speed = speed;
+    m_hasNext = false;
+    m_recordsReplayed = 0;
+    m_firstTimestamp = -1;
+
+    m_replayTimer.setSingleShot(true);
+    connect(&m_replayTimer, SIGNAL(timeout()), this, SLOT(replayNext()));
+}
+
+bool
+IRCReplayDevice::open(OpenMode mode)
+{
+    if(!m_reader.open(m_fileName))
+    {
+        setErrorString(QString("%1 is not a capture.").arg(m_fileName));
+        return false;
+    }
+
+    m_buffer.clear();
+    m_recordsReplayed = 0;
+    m_firstTimestamp = -1;
+    m_clock.start();
+    if(!QIODevice::open(mode | QIODevice::Unbuffered))
+        return false;
+    scheduleNext();
+    return true;
+}
+
+void
+IRCReplayDevice::close()
+{
+    m_replayTimer.stop();
+    m_reader.close();
+    m_hasNext = false;
+    m_buffer.clear();
+    QIODevice::close();
+}
+
+bool
+IRCReplayDevice::isSequential() const
+{
+    return true;
+}
+
+qint64
+IRCReplayDevice::bytesAvailable() const
+{
+    return m_buffer.size() + QIODevice::bytesAvailable();
+}
+
+qint64
+IRCReplayDevice::recordsReplayed() const
+{
+    return m_recordsReplayed;
+}
+
+qint64
+IRCReplayDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 size = qMin(maxSize, qint64(m_buffer.size()));
+    memcpy(data, m_buffer.constData(), size);
+    m_buffer.remove(0, int(size));
+
+    // At full speed, the next record follows once this one has been read.
+    if(m_buffer.isEmpty() && m_speed == FullSpeed && m_hasNext && !m_replayTimer.isActive())
+        m_replayTimer.start(0);
+    return size;
+}
+
+qint64
+IRCReplayDevice::writeData(const char *data, qint64 maxSize)
+{
+    // What the client says does not change what the server said.
+    Q_UNUSED(data);
+    return maxSize;
+}
+
+void
+IRCReplayDevice::replayNext()
+{
+    if(!m_hasNext)
+        return;
+
+    m_buffer.append(m_next.data);
+    m_recordsReplayed++;
+    scheduleNext();
+    emit readyRead();
+}
+
+void
+IRCReplayDevice::scheduleNext()
+{
+    // Only the server side is played back, the client writes its own lines.
+    m_hasNext = false;
+    while(m_reader.readNext(m_next))
+    {
+        if(m_next.direction == IRCCapture::Inbound)
+        {
+            m_hasNext = true;
+            break;
+        }
+    }
+
+    if(!m_hasNext)
+    {
+        m_reader.close();
+        // Let the reader take the last record before the stream ends.
+        QMetaObject::invokeMethod(this, "readChannelFinished", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+        return;
+    }
+
+    if(m_firstTimestamp < 0)
+        m_firstTimestamp = m_next.timestamp;
+
+    if(m_speed == FullSpeed)
+    {
+        if(m_buffer.isEmpty())
+            m_replayTimer.start(0);
+        return;
+    }
+
+    qint64 due = (m_next.timestamp - m_firstTimestamp) / 1000000;
+    m_replayTimer.start(int(qMax(Q_INT64_C(0), due - m_clock.elapsed())));
+}
@@ -0,0 +1,84 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "irccapture.h"
+
+// Qt includes
+#include <QIODevice>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+  * \class IRCReplayDevice
+  * Stands in for the socket of a client and plays back what the server sent
+  * during a capture. Every inbound record becomes readable on its own, so
+  * the client reads the stream in the chunks it originally arrived in.
+  * Everything the client writes is accepted and dropped. Pass the open
+  * device to IRCClient::connectToDevice().
+  */
+class IRCReplayDevice :
+        public QIODevice {
+    Q_OBJECT
+public:
+    enum Speed {
+        /** Keeps the time between records as captured. */
+        OriginalSpeed,
+        /** Hands out the next record as soon as the previous one was read. */
+        FullSpeed
+    };
+
+    IRCReplayDevice(const QString& fileName, Speed speed = OriginalSpeed,
+                    QObject *parent = 0);
+
+    /** Opens the capture. Playback starts with the next event loop turn. */
+    bool open(OpenMode mode);
+    void close();
+
+    bool isSequential() const;
+    qint64 bytesAvailable() const;
+
+    /** Number of inbound records handed out so far. */
+    qint64 recordsReplayed() const;
+
+signals:
+    /** Sent when the whole capture has been played back. */
+    void finished();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+private slots:
+    void replayNext();
+
+private:
+    void scheduleNext();
+
+    QString            m_fileName;
+    Speed              m_speed;
+    IRCCaptureReader   m_reader;
+    IRCCapture::Record m_next;
+    bool               m_hasNext;
+    QByteArray         m_buffer;
+    qint64             m_recordsReplayed;
+    qint64             m_firstTimestamp;
+    QElapsedTimer      m_clock;
+    QTimer             m_replayTimer;
+};
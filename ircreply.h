@@ -27,6 +27,7 @@ const int YourHost = 2;
 const int Created = 3;
 const int MyInfo = 4;
 const int ReplyBounce = 5;
+const int ISupport = 5;
 const int UserHost = 302;
 const int IsOn = 303;
 const int Away = 301;
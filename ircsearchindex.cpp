@@ -0,0 +1,479 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircsearchindex.h"
+#include "ircatomtable.h"
+
+// Qt includes
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QStringList>
+
+namespace {
+const quint32 IndexMagic = 0x51495258; // "QIRX"
+const quint32 IndexVersion = 1;
+}
+
+IRCSearchIndex::IRCSearchIndex()
+{
+    m_generation = 0;
+}
+
+int
+IRCSearchIndex::addMessage(int channelAtom, int nickAtom, qint64 offset, const QString &message)
+{
+    const int number = m_documents.size();
+    Document document;
+    document.channelAtom = channelAtom;
+    document.nickAtom = nickAtom;
+    document.offset = offset;
+    m_documents.append(document);
+
+    QByteArray text = foldText(message);
+    for(int i = 0; i + 3 <= text.size(); i++)
+    {
+        int &slot = m_postingsByTrigram[trigram(text.constData() + i)];
+        if(slot == 0)
+        {
+            Postings postings;
+            postings.lastDocument = -1;
+            postings.count = 0;
+            m_postings.append(postings);
+            slot = m_postings.size();
+        }
+
+        Postings &postings = m_postings[slot - 1];
+        if(postings.lastDocument != number)
+            appendDelta(postings, number);
+    }
+    return number;
+}
+
+int
+IRCSearchIndex::documentCount() const
+{
+    return m_documents.size();
+}
+
+const IRCSearchIndex::Document &
+IRCSearchIndex::document(int number) const
+{
+    return m_documents.at(number);
+}
+
+qint64
+IRCSearchIndex::claimChannel(int channelAtom, const QString &logFileName)
+{
+    QHash<int, Coverage>::iterator coverage = m_coverage.find(channelAtom);
+    if(coverage != m_coverage.end() && coverage->logFileName == logFileName)
+        return coverage->records;
+
+    removeChannel(channelAtom);
+    Coverage newCoverage;
+    newCoverage.logFileName = logFileName;
+    newCoverage.records = 0;
+    m_coverage.insert(channelAtom, newCoverage);
+    return 0;
+}
+
+void
+IRCSearchIndex::setIndexedRecords(int channelAtom, qint64 records)
+{
+    QHash<int, Coverage>::iterator coverage = m_coverage.find(channelAtom);
+    if(coverage != m_coverage.end())
+        coverage->records = records;
+}
+
+QString
+IRCSearchIndex::logFileName(int channelAtom) const
+{
+    return m_coverage.value(channelAtom).logFileName;
+}
+
+void
+IRCSearchIndex::removeChannel(int channelAtom)
+{
+    m_coverage.remove(channelAtom);
+
+    // Documents are numbered densely, so the remaining ones are numbered
+    // anew and every postings list is encoded again.
+    QVector<int> numbers(m_documents.size());
+    int kept = 0;
+    for(int i = 0; i < m_documents.size(); i++)
+    {
+        if(m_documents.at(i).channelAtom == channelAtom)
+        {
+            numbers[i] = -1;
+        }
+        else
+        {
+            numbers[i] = kept;
+            m_documents[kept++] = m_documents.at(i);
+        }
+    }
+    if(kept == m_documents.size())
+        return;
+    m_documents.resize(kept);
+
+    for(int i = 0; i < m_postings.size(); i++)
+    {
+        Postings &postings = m_postings[i];
+        const QByteArray data = postings.data;
+        const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+        postings.data.resize(0);
+        postings.lastDocument = -1;
+        postings.count = 0;
+
+        int document = -1;
+        int position = 0;
+        while(position < data.size())
+        {
+            quint32 delta = 0;
+            int shift = 0;
+            uchar byte;
+            do
+            {
+                byte = bytes[position++];
+                delta |= quint32(byte & 0x7f) << shift;
+                shift += 7;
+            }
+            while((byte & 0x80) && position < data.size());
+
+            document += int(delta);
+            if(numbers.at(document) >= 0)
+                appendDelta(postings, numbers.at(document));
+        }
+        postings.data.squeeze();
+    }
+    m_generation++;
+}
+
+void
+IRCSearchIndex::clear()
+{
+    m_documents.clear();
+    m_postings.clear();
+    m_postingsByTrigram.clear();
+    m_coverage.clear();
+    m_generation++;
+}
+
+bool
+IRCSearchIndex::save(const QString &fileName, const IRCAtomTable *atomTable) const
+{
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    // Atom ids only hold for this session, so the file names channels and
+    // nicks and refers to them by their position in that list.
+    QHash<int, qint32> names;
+    QStringList nameList;
+    QVector<qint32> documentNames;
+    documentNames.reserve(m_documents.size() * 2);
+    for(int i = 0; i < m_documents.size(); i++)
+    {
+        const int atoms[2] = { m_documents.at(i).channelAtom, m_documents.at(i).nickAtom };
+        for(int j = 0; j < 2; j++)
+        {
+            qint32 &name = names[atoms[j]];
+            if(name == 0)
+            {
+                nameList.append(atomTable->name(atoms[j]));
+                name = nameList.size();
+            }
+            documentNames.append(name - 1);
+        }
+    }
+
+    QDataStream out(&file);
+    out << IndexMagic << IndexVersion << nameList;
+
+    out << qint32(m_documents.size());
+    for(int i = 0; i < m_documents.size(); i++)
+        out << documentNames.at(2 * i) << documentNames.at(2 * i + 1) << m_documents.at(i).offset;
+
+    out << qint32(m_coverage.size());
+    for(QHash<int, Coverage>::const_iterator coverage = m_coverage.constBegin();
+        coverage != m_coverage.constEnd(); ++coverage)
+    {
+        out << atomTable->name(coverage.key()) << coverage->logFileName << coverage->records;
+    }
+
+    out << qint32(m_postingsByTrigram.size());
+    for(QHash<quint32, int>::const_iterator slot = m_postingsByTrigram.constBegin();
+        slot != m_postingsByTrigram.constEnd(); ++slot)
+    {
+        const Postings &postings = m_postings.at(slot.value() - 1);
+        out << slot.key() << qint32(postings.lastDocument) << qint32(postings.count)
+            << postings.data;
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool
+IRCSearchIndex::load(const QString &fileName, IRCAtomTable *atomTable)
+{
+    clear();
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic;
+    quint32 version;
+    QStringList nameList;
+    in >> magic >> version;
+    if(magic != IndexMagic || version != IndexVersion)
+        return false;
+    in >> nameList;
+
+    QVector<int> atoms(nameList.size());
+    for(int i = 0; i < nameList.size(); i++)
+        atoms[i] = atomTable->intern(nameList.at(i));
+
+    qint32 count;
+    in >> count;
+    m_documents.reserve(qMax(count, 0));
+    for(qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        qint32 channelName;
+        qint32 nickName;
+        Document document;
+        in >> channelName >> nickName >> document.offset;
+        if(channelName < 0 || channelName >= atoms.size()
+        || nickName < 0 || nickName >= atoms.size())
+        {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        document.channelAtom = atoms.at(channelName);
+        document.nickAtom = atoms.at(nickName);
+        m_documents.append(document);
+    }
+
+    in >> count;
+    for(qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        QString channelName;
+        Coverage coverage;
+        in >> channelName >> coverage.logFileName >> coverage.records;
+        m_coverage.insert(atomTable->intern(channelName), coverage);
+    }
+
+    in >> count;
+    m_postings.reserve(qMax(count, 0));
+    for(qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    {
+        quint32 key;
+        qint32 lastDocument;
+        qint32 postingsCount;
+        Postings postings;
+        in >> key >> lastDocument >> postingsCount >> postings.data;
+        if(lastDocument >= m_documents.size())
+        {
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        postings.lastDocument = lastDocument;
+        postings.count = postingsCount;
+        m_postings.append(postings);
+        m_postingsByTrigram.insert(key, m_postings.size());
+    }
+
+    if(in.status() != QDataStream::Ok)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+QByteArray
+IRCSearchIndex::foldText(const QString &text)
+{
+    return text.toCaseFolded().toUtf8();
+}
+
+quint32
+IRCSearchIndex::trigram(const char *data)
+{
+    return (quint32(uchar(data[0])) << 16)
+         | (quint32(uchar(data[1])) << 8)
+         | quint32(uchar(data[2]));
+}
+
+void
+IRCSearchIndex::appendDelta(Postings &postings, int document)
+{
+    // Seven bits per byte, the high bit marks that more bytes follow.
+    quint32 delta = quint32(document - postings.lastDocument);
+    while(delta >= 0x80)
+    {
+        postings.data.append(char(delta | 0x80));
+        delta >>= 7;
+    }
+    postings.data.append(char(delta));
+    postings.lastDocument = document;
+    postings.count++;
+}
+
+IRCSearchIndex::Query::Query(const IRCSearchIndex *index, const QString &text,
+                             int nickAtom, int channelAtom)
+{
+    m_index = index;
+    m_nickAtom = nickAtom;
+    m_channelAtom = channelAtom;
+    m_documentLimit = index->documentCount();
+    m_nextDocument = 0;
+    m_generation = index->m_generation;
+
+    // Texts too short for a trigram are searched for in every document.
+    QByteArray folded = foldText(text);
+    m_scan = folded.size() < 3;
+    for(int i = 0; !m_scan && i + 3 <= folded.size(); i++)
+    {
+        int slot = index->m_postingsByTrigram.value(trigram(folded.constData() + i));
+        if(slot == 0)
+        {
+            // Nothing contains this trigram, so nothing can match.
+            m_documentLimit = 0;
+            return;
+        }
+
+        bool known = false;
+        for(int j = 0; j < m_cursors.size(); j++)
+            known = known || m_cursors.at(j).postings == slot - 1;
+        if(known)
+            continue;
+
+        Cursor cursor;
+        cursor.postings = slot - 1;
+        cursor.position = 0;
+        cursor.document = -1;
+
+        // Keep the rarest trigram first, it drives the intersection.
+        int position = 0;
+        const int count = index->m_postings.at(slot - 1).count;
+        while(position < m_cursors.size()
+              && index->m_postings.at(m_cursors.at(position).postings).count <= count)
+            position++;
+        m_cursors.insert(position, cursor);
+    }
+}
+
+int
+IRCSearchIndex::Query::next()
+{
+    // The documents have been numbered anew since the query started.
+    if(m_generation != m_index->m_generation)
+        return -1;
+
+    if(m_scan)
+    {
+        while(m_nextDocument < m_documentLimit)
+        {
+            int document = m_nextDocument++;
+            if(accepts(document))
+                return document;
+        }
+        return -1;
+    }
+
+    if(m_documentLimit == 0 || m_cursors.isEmpty())
+        return -1;
+
+    Cursor &first = m_cursors[0];
+    if(!advance(first))
+        return -1;
+
+    for(;;)
+    {
+        // Move all other lists to the candidate. If one of them skips past
+        // it, that document becomes the next candidate.
+        int candidate = first.document;
+        if(candidate >= m_documentLimit)
+            return -1;
+
+        bool agreed = true;
+        for(int i = 1; i < m_cursors.size() && agreed; i++)
+        {
+            if(!advanceTo(m_cursors[i], candidate))
+                return -1;
+            if(m_cursors.at(i).document != candidate)
+            {
+                if(!advanceTo(first, m_cursors.at(i).document))
+                    return -1;
+                agreed = false;
+            }
+        }
+
+        if(agreed)
+        {
+            if(accepts(candidate))
+                return candidate;
+            if(!advance(first))
+                return -1;
+        }
+    }
+}
+
+bool
+IRCSearchIndex::Query::advance(Cursor &cursor)
+{
+    const QByteArray &data = m_index->m_postings.at(cursor.postings).data;
+    const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+    if(cursor.position >= data.size())
+        return false;
+
+    quint32 delta = 0;
+    int shift = 0;
+    uchar byte;
+    do
+    {
+        byte = bytes[cursor.position++];
+        delta |= quint32(byte & 0x7f) << shift;
+        shift += 7;
+    }
+    while((byte & 0x80) && cursor.position < data.size());
+
+    cursor.document += int(delta);
+    return true;
+}
+
+bool
+IRCSearchIndex::Query::advanceTo(Cursor &cursor, int document)
+{
+    while(cursor.document < document)
+    {
+        if(!advance(cursor))
+            return false;
+    }
+    return true;
+}
+
+bool
+IRCSearchIndex::Query::accepts(int document) const
+{
+    const Document &entry = m_index->document(document);
+    return (m_nickAtom == IRCAtomTable::InvalidAtom || entry.nickAtom == m_nickAtom)
+        && (m_channelAtom == IRCAtomTable::InvalidAtom || entry.channelAtom == m_channelAtom);
+}
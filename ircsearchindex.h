@@ -0,0 +1,159 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+class IRCAtomTable;
+
+/**
+  * \class IRCSearchIndex
+  * Inverted index over messages for substring search. Every message is a
+  * document, identified by a number that grows with every added message.
+  * For each trigram of the case folded UTF-8 text of the messages, the
+  * index holds the numbers of the documents containing it, delta encoded
+  * as variable length integers.
+  *
+  * Documents only refer to their message in the log of their channel, so
+  * the index does not keep a copy of the text. For every channel the index
+  * remembers which log it covers and how many of its records have been
+  * added, so saving the index and loading it in a later session only leaves
+  * the records logged in between to be indexed.
+  */
+class IRCSearchIndex {
+public:
+    struct Document {
+        qint32  channelAtom;
+        qint32  nickAtom;
+        /** Offset of the message in the log, see IRCChannelLog::readAt(). */
+        qint64  offset;
+    };
+
+    /**
+      * Enumerates the documents that may contain a text, in ascending
+      * order. Candidates contain all trigrams of the text, but still have to
+      * be checked for the text itself. Documents added after the query has
+      * been created are not considered. Removing documents from the index
+      * ends the query.
+      */
+    class Query {
+    public:
+        /**
+          * \arg text The text to search for.
+          * \arg nickAtom Only consider messages of this nick, unless it is
+          * IRCAtomTable::InvalidAtom.
+          * \arg channelAtom Only consider messages of this channel, unless it
+          * is IRCAtomTable::InvalidAtom.
+          */
+        Query(const IRCSearchIndex *index, const QString& text,
+              int nickAtom, int channelAtom);
+
+        /** Returns the next candidate document or -1 when there is none. */
+        int next();
+
+    private:
+        struct Cursor {
+            int postings;
+            int position;
+            int document;
+        };
+
+        bool advance(Cursor& cursor);
+        bool advanceTo(Cursor& cursor, int document);
+        bool accepts(int document) const;
+
+        const IRCSearchIndex *  m_index;
+        QVector<Cursor>         m_cursors;
+        int                     m_nickAtom;
+        int                     m_channelAtom;
+        int                     m_documentLimit;
+        int                     m_nextDocument;
+        int                     m_generation;
+        bool                    m_scan;
+    };
+
+    IRCSearchIndex();
+
+    /**
+      * Adds a message to the index.
+      * \arg channelAtom Atom id of the channel.
+      * \arg nickAtom Atom id of the sender.
+      * \arg offset Offset of the message in the log of the channel.
+      * \arg message The text of the message.
+      * \return The number of the new document.
+      */
+    int addMessage(int channelAtom, int nickAtom, qint64 offset, const QString& message);
+
+    int documentCount() const;
+    const Document& document(int number) const;
+
+    /**
+      * Returns how many records of the log \a logFileName of a channel have
+      * been added. If the index covers another log of the channel, its
+      * documents are removed first.
+      */
+    qint64 claimChannel(int channelAtom, const QString& logFileName);
+
+    /** Notes that the first \a records records of the channel's log are added. */
+    void setIndexedRecords(int channelAtom, qint64 records);
+
+    /** Returns the name of the log the documents of a channel refer to. */
+    QString logFileName(int channelAtom) const;
+
+    /** Removes all documents of a channel. */
+    void removeChannel(int channelAtom);
+
+    /** Removes all documents. */
+    void clear();
+
+    /** Writes the index to \a fileName, naming atoms by \a atomTable. */
+    bool save(const QString& fileName, const IRCAtomTable *atomTable) const;
+
+    /**
+      * Replaces the index with the one saved to \a fileName, interning the
+      * names of channels and nicks in \a atomTable. On failure the index is
+      * left empty.
+      */
+    bool load(const QString& fileName, IRCAtomTable *atomTable);
+
+private:
+    struct Postings {
+        QByteArray  data;
+        int         lastDocument;
+        int         count;
+    };
+
+    struct Coverage {
+        QString logFileName;
+        qint64  records;
+    };
+
+    static QByteArray foldText(const QString& text);
+    static quint32 trigram(const char *data);
+    static void appendDelta(Postings& postings, int document);
+
+    QVector<Document>       m_documents;
+    QVector<Postings>       m_postings;
+    QHash<quint32, int>     m_postingsByTrigram;
+    QHash<int, Coverage>    m_coverage;
+    int                     m_generation;
+};
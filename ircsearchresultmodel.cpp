@@ -0,0 +1,208 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircsearchresultmodel.h"
+#include "ircclient.h"
+
+// Qt includes
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+
+IRCSearchResultModel::IRCSearchResultModel(IRCClient *ircClient, QObject *parent) :
+    QAbstractListModel(parent)
+{
+    m_ircClient = ircClient;
+    m_searchTime = 0;
+    m_sliceTimer.setInterval(0);
+    connect(&m_sliceTimer, SIGNAL(timeout()), this, SLOT(searchSlice()));
+}
+
+IRCSearchResultModel::~IRCSearchResultModel()
+{
+    closeChannelLogs();
+}
+
+int
+IRCSearchResultModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+        return 0;
+    return m_results.size();
+}
+
+QVariant
+IRCSearchResultModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= m_results.size())
+        return QVariant();
+
+    const Result &result = m_results.at(index.row());
+    IRCAtomTable *atomTable = m_ircClient->atomTable();
+    switch(role)
+    {
+    case Qt::DisplayRole:
+        return atomTable->name(result.channelAtom) + " <"
+             + atomTable->name(result.nickAtom) + "> " + result.message;
+    case ChannelRole:
+        return atomTable->name(result.channelAtom);
+    case NickRole:
+        return atomTable->name(result.nickAtom);
+    case MessageRole:
+        return result.message;
+    case TimestampRole:
+        return QDateTime::fromMSecsSinceEpoch(result.timestamp);
+    default:
+        return QVariant();
+    }
+}
+
+bool
+IRCSearchResultModel::isSearching() const
+{
+    return m_sliceTimer.isActive();
+}
+
+qint64
+IRCSearchResultModel::searchTime() const
+{
+    return m_searchTime;
+}
+
+void
+IRCSearchResultModel::search(const QString &text, const QString &nick, const QString &channel)
+{
+    beginResetModel();
+    m_results.clear();
+    endResetModel();
+    m_searchTime = 0;
+    closeChannelLogs();
+
+    IRCAtomTable *atomTable = m_ircClient->atomTable();
+    int nickAtom = IRCAtomTable::InvalidAtom;
+    int channelAtom = IRCAtomTable::InvalidAtom;
+    if((!nick.isEmpty() && (nickAtom = atomTable->find(nick)) == IRCAtomTable::InvalidAtom)
+    || (!channel.isEmpty() && (channelAtom = atomTable->find(channel)) == IRCAtomTable::InvalidAtom))
+    {
+        // Nobody by that name has ever been seen.
+        m_query.reset();
+        m_sliceTimer.stop();
+        emit searchFinished(0);
+        return;
+    }
+
+    m_text = text;
+    m_query.reset(new IRCSearchIndex::Query(m_ircClient->searchIndex(), text,
+                                            nickAtom, channelAtom));
+    m_sliceTimer.start();
+}
+
+void
+IRCSearchResultModel::cancel()
+{
+    m_query.reset();
+    m_sliceTimer.stop();
+    closeChannelLogs();
+}
+
+void
+IRCSearchResultModel::searchSlice()
+{
+    if(!m_query)
+    {
+        m_sliceTimer.stop();
+        return;
+    }
+
+    const IRCSearchIndex *searchIndex = m_ircClient->searchIndex();
+    QVector<Result> matches;
+    IRCChannelLog::Record record;
+    bool finished = false;
+
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+    while(elapsedTimer.elapsed() < SliceTime)
+    {
+        int document = m_query->next();
+        if(document < 0 || m_results.size() + matches.size() >= MaximumResults)
+        {
+            finished = true;
+            break;
+        }
+
+        // Candidates contain every trigram of the text, the text itself is
+        // checked against the logged message, which is read directly at its
+        // offset.
+        const IRCSearchIndex::Document entry = searchIndex->document(document);
+        if(!channelLog(entry.channelAtom)->readAt(entry.offset, record)
+        || !record.payload.contains(m_text, Qt::CaseInsensitive))
+            continue;
+
+        Result result;
+        result.timestamp = record.timestamp;
+        result.channelAtom = entry.channelAtom;
+        result.nickAtom = entry.nickAtom;
+        result.message = record.payload;
+        matches.append(result);
+    }
+    m_searchTime += elapsedTimer.elapsed();
+
+    if(!matches.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), m_results.size(),
+                        m_results.size() + matches.size() - 1);
+        m_results += matches;
+        endInsertRows();
+    }
+
+    if(finished)
+    {
+        m_query.reset();
+        m_sliceTimer.stop();
+        closeChannelLogs();
+        emit searchFinished(m_results.size());
+    }
+}
+
+IRCChannelLog *
+IRCSearchResultModel::channelLog(int channelAtom)
+{
+    // The log of a channel in use knows about the records it appended
+    // since it was opened, a log opened here might not.
+    IRCChannel *channel = m_ircClient->findChannel(m_ircClient->atomTable()->name(channelAtom));
+    if(channel && channel->channelLog()->isOpen())
+        return channel->channelLog();
+
+    // Logs that cannot be opened stay closed, reading from them fails.
+    QString fileName = m_ircClient->searchIndex()->logFileName(channelAtom);
+    IRCChannelLog *&channelLog = m_channelLogs[fileName];
+    if(!channelLog)
+    {
+        channelLog = new IRCChannelLog;
+        if(!fileName.isEmpty() && QFile::exists(fileName))
+            channelLog->open(fileName);
+    }
+    return channelLog;
+}
+
+void
+IRCSearchResultModel::closeChannelLogs()
+{
+    qDeleteAll(m_channelLogs);
+    m_channelLogs.clear();
+}
@@ -0,0 +1,116 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircsearchindex.h"
+#include "ircchannellog.h"
+class IRCClient;
+
+// Qt includes
+#include <QAbstractListModel>
+#include <QHash>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QVector>
+
+/**
+  * \class IRCSearchResultModel
+  * Runs a search over the messages of all channels of a client and lists
+  * the matches. The search proceeds in short slices on the event loop, so
+  * matches appear while it is running and the user interface stays
+  * responsive.
+  *
+  * Matches are read from the logs of their channels. Channels that are
+  * not in use are not created for that; the search opens their logs by
+  * itself while it runs.
+  */
+class IRCSearchResultModel :
+        public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        ChannelRole = Qt::UserRole + 1,
+        NickRole,
+        MessageRole,
+        TimestampRole
+    };
+
+    /** Milliseconds spent searching before returning to the event loop. */
+    static const int SliceTime = 10;
+
+    /** The search stops after this many matches. */
+    static const int MaximumResults = 10000;
+
+    IRCSearchResultModel(IRCClient *ircClient, QObject *parent = 0);
+    ~IRCSearchResultModel();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    bool isSearching() const;
+
+    /**
+      * Milliseconds the current or last search has spent in its slices,
+      * without the time the event loop ran in between.
+      */
+    qint64 searchTime() const;
+
+signals:
+    /**
+      * Sent when a search has completed.
+      * \arg matches The number of matches found.
+      */
+    void searchFinished(int matches);
+
+public slots:
+    /**
+      * Starts searching for messages containing \a text, ignoring case.
+      * Previous results are discarded.
+      * \arg nick Only list messages of this nick, unless it is empty.
+      * \arg channel Only list messages of this channel, unless it is empty.
+      */
+    void search(const QString& text,
+                const QString& nick = QString(),
+                const QString& channel = QString());
+
+    /** Stops the running search, keeping the matches found so far. */
+    void cancel();
+
+private slots:
+    void searchSlice();
+
+private:
+    struct Result {
+        qint64  timestamp;
+        int     channelAtom;
+        int     nickAtom;
+        QString message;
+    };
+
+    IRCChannelLog *channelLog(int channelAtom);
+    void closeChannelLogs();
+
+    IRCClient *                             m_ircClient;
+    QScopedPointer<IRCSearchIndex::Query>   m_query;
+    QString                                 m_text;
+    QVector<Result>                         m_results;
+    QHash<QString, IRCChannelLog*>          m_channelLogs;
+    QTimer                                  m_sliceTimer;
+    qint64                                  m_searchTime;
+};
@@ -0,0 +1,251 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircsendqueue.h"
+#include "irccapture.h"
+#include "ircclientmetrics.h"
+
+// Standard includes
+#include <string.h>
+
+IRCSendQueue::IRCSendQueue(QObject *parent) :
+    QObject(parent),
+    m_flushTimer(this)
+{
+    m_device = 0;
+    m_capture = 0;
+    m_metrics = 0;
+    m_normalOffset = 0;
+    m_normalCount = 0;
+    m_urgentCount = 0;
+
+    // Reserving marks the buffers so that emptying them keeps their storage.
+    m_normalLines.reserve(4096);
+    m_urgentLines.reserve(512);
+    m_writeBuffer.reserve(4096);
+
+    // Most servers allow a short burst and then about one line every two
+    // seconds before they start penalizing a client.
+    m_burst = 5;
+    m_interval = 2000;
+    m_tokens = m_burst;
+    m_refillTimer.start();
+
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void
+IRCSendQueue::setDevice(QIODevice *device)
+{
+    m_device = device;
+}
+
+void
+IRCSendQueue::setCapture(IRCCapture *capture)
+{
+    m_capture = capture;
+}
+
+void
+IRCSendQueue::setMetrics(IRCClientMetrics *metrics)
+{
+    m_metrics = metrics;
+}
+
+void
+IRCSendQueue::setFloodControl(int burst, int interval)
+{
+    m_burst = qMax(1, burst);
+    m_interval = qMax(0, interval);
+    m_tokens = qMin(m_tokens, (double)m_burst);
+    schedule();
+}
+
+int
+IRCSendQueue::burst() const
+{
+    return m_burst;
+}
+
+int
+IRCSendQueue::interval() const
+{
+    return m_interval;
+}
+
+void
+IRCSendQueue::enqueue(const char *line, int length, Priority priority)
+{
+    const char *lineBreak = static_cast<const char*>(memchr(line, '\n', length));
+    if(lineBreak)
+        length = lineBreak - line;
+    lineBreak = static_cast<const char*>(memchr(line, '\r', length));
+    if(lineBreak)
+        length = lineBreak - line;
+
+    if(priority == Urgent)
+    {
+        m_urgentLines.append(line, length).append("\r\n", 2);
+        m_urgentCount++;
+    }
+    else
+    {
+        // Written lines stay in front of the read offset until they make up
+        // half of the buffer, so every byte is moved at most once more.
+        if(m_normalOffset > m_normalLines.size() / 2)
+        {
+            m_normalLines.remove(0, m_normalOffset);
+            m_normalOffset = 0;
+        }
+        m_normalLines.append(line, length).append("\r\n", 2);
+        m_normalCount++;
+    }
+
+    emit depthChanged(depth());
+    schedule();
+}
+
+int
+IRCSendQueue::depth() const
+{
+    return m_normalCount + m_urgentCount;
+}
+
+void
+IRCSendQueue::clear()
+{
+    m_flushTimer.stop();
+    m_normalLines.resize(0);
+    m_normalOffset = 0;
+    m_urgentLines.resize(0);
+    bool changed = depth() > 0;
+    m_normalCount = 0;
+    m_urgentCount = 0;
+    if(changed)
+        emit depthChanged(0);
+}
+
+void
+IRCSendQueue::flush()
+{
+    if(!m_device || !m_device->isOpen())
+        return;
+
+    refill();
+
+    int lines = m_normalCount;
+    if(m_interval > 0)
+        lines = qMin(lines, (int)m_tokens);
+    int normalBytes = lineBytes(lines);
+
+    // Coalesce everything that is due into one write.
+    const char *data;
+    int size;
+    if(m_urgentCount == 0)
+    {
+        data = m_normalLines.constData() + m_normalOffset;
+        size = normalBytes;
+    }
+    else if(normalBytes == 0)
+    {
+        data = m_urgentLines.constData();
+        size = m_urgentLines.size();
+    }
+    else
+    {
+        m_writeBuffer.resize(0);
+        m_writeBuffer.append(m_urgentLines.constData(), m_urgentLines.size());
+        m_writeBuffer.append(m_normalLines.constData() + m_normalOffset, normalBytes);
+        data = m_writeBuffer.constData();
+        size = m_writeBuffer.size();
+    }
+
+    if(size > 0)
+    {
+        qint64 written = m_device->write(data, size);
+        if(m_metrics && written > 0)
+            m_metrics->recordSent(lines + m_urgentCount, written);
+        if(m_capture && m_capture->isOpen()
+           && !m_capture->record(IRCCapture::Outbound, data, size))
+            emit captureFailed(QString("Could not write the capture %1: %2")
+                               .arg(m_capture->fileName(), m_capture->errorString()));
+    }
+
+    // Urgent lines count against the limit as well, the server does not
+    // know they were urgent.
+    if(m_interval > 0)
+        m_tokens = qMax(0.0, m_tokens - lines - m_urgentCount);
+
+    m_normalCount -= lines;
+    if(m_normalCount == 0)
+    {
+        m_normalLines.resize(0);
+        m_normalOffset = 0;
+    }
+    else
+        m_normalOffset += normalBytes;
+    m_urgentLines.resize(0);
+    m_urgentCount = 0;
+
+    if(size > 0)
+        emit depthChanged(depth());
+    schedule();
+}
+
+void
+IRCSendQueue::refill()
+{
+    qint64 elapsed = m_refillTimer.restart();
+    if(m_interval > 0)
+        m_tokens = qMin((double)m_burst, m_tokens + (double)elapsed / m_interval);
+    else
+        m_tokens = m_burst;
+}
+
+void
+IRCSendQueue::schedule()
+{
+    if(m_flushTimer.isActive() || depth() == 0)
+        return;
+
+    // Anything we can send right away goes out with the next turn of the
+    // event loop, together with whatever else is queued until then.
+    refill();
+    if(m_urgentCount > 0 || m_interval == 0 || m_tokens >= 1.0)
+        m_flushTimer.start(0);
+    else
+        m_flushTimer.start((int)((1.0 - m_tokens) * m_interval) + 1);
+}
+
+int
+IRCSendQueue::lineBytes(int count) const
+{
+    // Returns the number of bytes the first count unwritten normal lines
+    // take up.
+    const char *data = m_normalLines.constData() + m_normalOffset;
+    int size = m_normalLines.size() - m_normalOffset;
+    int bytes = 0;
+    while(count-- > 0)
+    {
+        const char *terminator = static_cast<const char*>(
+                    memchr(data + bytes, '\n', size - bytes));
+        bytes = terminator - data + 1;
+    }
+    return bytes;
+}
@@ -0,0 +1,117 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QObject>
+#include <QByteArray>
+#include <QIODevice>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class IRCCapture;
+class IRCClientMetrics;
+
+/**
+  * \class IRCSendQueue
+  * Outbound scheduler for a single connection. Lines queued during one turn
+  * of the event loop are written in a single write. Normal lines are paced
+  * by a token bucket so that bursts stay within the flood limits of the
+  * server; urgent lines such as PONG replies are written first and are
+  * never held back.
+  */
+class IRCSendQueue :
+    public QObject {
+    Q_OBJECT
+public:
+    enum Priority {
+        Normal,
+        Urgent
+    };
+
+    IRCSendQueue(QObject *parent = 0);
+
+    void setDevice(QIODevice *device);
+
+    /** Records every write into \a capture, while it is open. */
+    void setCapture(IRCCapture *capture);
+
+    /** Counts the lines and bytes written in \a metrics. */
+    void setMetrics(IRCClientMetrics *metrics);
+
+    /**
+    * Configures the token bucket.
+    * \arg burst Number of lines that may be sent back to back.
+    * \arg interval Milliseconds it takes to earn another line. Passing 0
+    * turns pacing off.
+    */
+    void setFloodControl(int burst, int interval);
+    int burst() const;
+    int interval() const;
+
+    /**
+    * Queues a line for sending. The line terminator is added here. Anything
+    * following an embedded line break is dropped, so a single call can never
+    * produce more than one line on the wire.
+    */
+    void enqueue(const char *line, int length, Priority priority = Normal);
+
+    /** Number of lines waiting to be written. */
+    int depth() const;
+
+    /** Drops all lines that have not been written yet. */
+    void clear();
+
+signals:
+    /**
+    * Sent when the number of lines waiting to be written changed.
+    * \arg depth The new number of waiting lines.
+    */
+    void depthChanged(int depth);
+
+    /**
+    * Sent when a write could not be recorded in the capture, which is
+    * closed then.
+    * \arg reason Description of what went wrong.
+    */
+    void captureFailed(const QString& reason);
+
+private slots:
+    void flush();
+
+private:
+    void refill();
+    void schedule();
+    int lineBytes(int count) const;
+
+    QIODevice *       m_device;
+    IRCCapture *      m_capture;
+    IRCClientMetrics *m_metrics;
+    QByteArray        m_normalLines;
+    int               m_normalOffset;
+    QByteArray        m_urgentLines;
+    QByteArray        m_writeBuffer;
+    int               m_normalCount;
+    int               m_urgentCount;
+
+    int               m_burst;
+    int               m_interval;
+    double            m_tokens;
+    QElapsedTimer     m_refillTimer;
+    QTimer            m_flushTimer;
+};
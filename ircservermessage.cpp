@@ -18,119 +18,189 @@
 // Own includes
 #include "ircservermessage.h"
 
+IRCServerMessage::IRCServerMessage (const QByteArray& serverMessage)
+    : m_serverMessage (serverMessage),
+      m_data (m_serverMessage.constData ()),
+      m_size (m_serverMessage.size ())
+{
+    parse ();
+}
+
 IRCServerMessage::IRCServerMessage (const QString& serverMessage)
+    : m_serverMessage (serverMessage.toUtf8 ()),
+      m_data (m_serverMessage.constData ()),
+      m_size (m_serverMessage.size ())
+{
+    parse ();
+}
+
+IRCServerMessage::IRCServerMessage (const char *serverMessage, int length)
+    : m_data (serverMessage),
+      m_size (length)
+{
+    parse ();
+}
+
+IRCServerMessage::IRCServerMessage (const QByteArray& buffer, int offset, int length)
+    : m_serverMessage (buffer),
+      m_data (m_serverMessage.constData () + offset),
+      m_size (length)
 {
-    if (serverMessage.isEmpty ())
+    parse ();
+}
+
+void
+IRCServerMessage::parse ()
+{
+    const Span empty = { 0, 0 };
+    m_codeNumber = -1;
+    m_isNumeric = false;
+    m_commandCode = IRCCommand::UnknownCode;
+    m_nick = m_user = m_host = m_command = empty;
+    m_parameterCount = 0;
+
+    const char *data = m_data;
+    int size = m_size;
+
+    // We need to chop off \r\n here.
+    if (size > 0 && data[size - 1] == '\n')
+        size--;
+    if (size > 0 && data[size - 1] == '\r')
+        size--;
+
+    if (size == 0)
         return;
 
     int position = 0;
-    QString buffer;
-
-    m_nick = "";
-    m_user = "";
-    m_host = "";
 
     // A server message starting with a prefix indicates
     // a prefix. A prefix has the format:
     // :nick!user@host
     // followed by a space character.
-    if (serverMessage.startsWith (":"))
+    if (data[0] == ':')
     {
         position++;
-        while ((position < serverMessage.size ())
-               &&(serverMessage.at (position) != '!')
-               && !serverMessage.at (position).isSpace ())
+        m_nick.offset = position;
+        while (position < size && data[position] != '!'
+               && data[position] != '@' && data[position] != ' ')
+            position++;
+        m_nick.length = position - m_nick.offset;
+
+        // If it belongs to the prefix, it must be concatenated seamlessly
+        // without any spaces.
+        if (position < size && data[position] == '!')
+        {
+            position++;
+            m_user.offset = position;
+            while (position < size && data[position] != '@'
+                   && data[position] != ' ')
+                position++;
+            m_user.length = position - m_user.offset;
+        }
+
+        if (position < size && data[position] == '@')
         {
-            buffer.append (serverMessage.at (position));
             position++;
+            m_host.offset = position;
+            while (position < size && data[position] != ' ')
+                position++;
+            m_host.length = position - m_host.offset;
         }
-        m_nick = buffer, buffer.clear (), position++;
-
-        // If it belongs to the prefix, it must be concatenanted neatlessly without
-        // any spaces.
-        if (position < serverMessage.size())
-            if (!serverMessage.at (position - 1).isSpace ())
-            {
-                while ((position < serverMessage.size ())
-                       && serverMessage.at (position) != '@')
-                {
-                    buffer.append (serverMessage.at (position));
-                    position++;
-                }
-                m_user = buffer, buffer.clear (), position++;
-            }
-
-        // If it belongs to the prefix, it must be concatenanted neatlessly without
-        // any spaces.
-        if (position < serverMessage.size())
-            if (!serverMessage.at (position - 1).isSpace ())
-            {
-                while ((position < serverMessage.size ())
-                       && serverMessage.at (position) != ' ')
-                {
-                    buffer.append (serverMessage.at (position));
-                    position++;
-                }
-                m_host = buffer, buffer.clear (), position++;
-            }
+
+        while (position < size && data[position] == ' ')
+            position++;
     }
 
     // The next part is the command. The command can either be numeric
     // or a written command.
-    while ((position < serverMessage.size ())
-           && !serverMessage.at (position).isSpace ())
+    m_command.offset = position;
+    bool allDigits = true;
+    while (position < size && data[position] != ' ')
     {
-        buffer.append (serverMessage.at (position));
+        if (data[position] < '0' || data[position] > '9')
+            allDigits = false;
         position++;
     }
-    m_command = buffer.toUpper (), buffer.clear (), position++;
-    m_codeNumber = m_command.toInt (&m_isNumeric);
+    m_command.length = position - m_command.offset;
+
+    if (allDigits && m_command.length > 0 && m_command.length <= 3)
+    {
+        m_isNumeric = true;
+        m_codeNumber = 0;
+        for (int i = m_command.offset; i < position; i++)
+            m_codeNumber = m_codeNumber * 10 + (data[i] - '0');
+    }
+    else
+    {
+        m_commandCode = IRCCommand::code (data + m_command.offset,
+                                          m_command.length);
+    }
 
     // Next: a list of parameters. If any of these parameters
     // starts with a colon, we have to read everything that follows
-    // as a single parameter.
-    bool readUntilEnd = false;
-    while (position < serverMessage.size ())
+    // as a single parameter. The same applies to the last possible
+    // parameter, which may omit the colon.
+    while (position < size && m_parameterCount < MaximumParameters)
     {
-        if (buffer.isEmpty () && !readUntilEnd && (serverMessage.at (position) == ':'))
+        while (position < size && data[position] == ' ')
+            position++;
+        if (position >= size)
+            break;
+
+        Span& parameter = m_parameters[m_parameterCount++];
+        if (data[position] == ':')
         {
-            readUntilEnd = true;
+            parameter.offset = position + 1;
+            parameter.length = size - parameter.offset;
+            break;
         }
-        else
+
+        parameter.offset = position;
+        if (m_parameterCount == MaximumParameters)
         {
-            if (readUntilEnd)
-            {
-                buffer.append (serverMessage.at (position));
-            }
-            else
-            {
-                if (serverMessage.at (position).isSpace ())
-                {
-                    if (!buffer.isEmpty ())
-                    {
-                        m_parameters.append (buffer);
-                        buffer.clear ();
-                    }
-                }
-                else
-                {
-                    buffer.append (serverMessage.at (position));
-                }
-            }
+            parameter.length = size - position;
+            break;
         }
-        position++;
-    }
 
-    if (!buffer.isEmpty ())
-    {
-        // We need to chop off \r\n here.
-        buffer.chop (2);
-        m_parameters.append (buffer);
+        while (position < size && data[position] != ' ')
+            position++;
+        parameter.length = position - parameter.offset;
     }
 }
 
+QString
+IRCServerMessage::decode (const Span& span) const
+{
+    return QString::fromUtf8 (m_data + span.offset, span.length);
+}
+
+QString
+IRCServerMessage::nick () const
+{
+    return decode (m_nick);
+}
+
+QString
+IRCServerMessage::user () const
+{
+    return decode (m_user);
+}
+
+QString
+IRCServerMessage::host () const
+{
+    return decode (m_host);
+}
+
+QString
+IRCServerMessage::command () const
+{
+    return QString::fromLatin1 (m_data + m_command.offset, m_command.length)
+            .toUpper ();
+}
+
 int
-IRCServerMessage::numericValue ()
+IRCServerMessage::numericValue () const
 {
     if (m_isNumeric)
         return m_codeNumber;
@@ -138,9 +208,9 @@ IRCServerMessage::numericValue ()
 }
 
 QString
-IRCServerMessage::parameter (int index)
+IRCServerMessage::parameter (int index) const
 {
-    if (index >= 0 && index < m_parameters.size ())
-        return m_parameters.at (index);
+    if (index >= 0 && index < m_parameterCount)
+        return decode (m_parameters[index]);
     return "";
 }
@@ -17,7 +17,11 @@
 
 #pragma once
 
+// Own includes
+#include "irccommand.h"
+
 // Qt includes
+#include <QByteArray>
 #include <QString>
 #include <QStringList>
 
@@ -26,29 +30,61 @@
   * The IRCServerMessage class is a wrapper for server messages.
   * It parses the server message into its single bits and makes these
   * available through Getter-methods.
+  * Parsing does not copy anything: the message keeps a reference to the
+  * received line and only records where each piece starts and how long it
+  * is. Pieces are decoded to QString when they are actually requested.
+  * Messages built from a raw character range do not even take a reference;
+  * the range has to outlive the message then. Messages built from a part of
+  * a buffer share that buffer, so many messages can be parsed from a single
+  * allocation and handed to another thread together.
   */
 class IRCServerMessage {
 public:
+  /** Maximum number of parameters a message may carry (RFC 2812). */
+  static const int MaximumParameters = 15;
+
+  IRCServerMessage (const QByteArray& serverMessage);
   IRCServerMessage (const QString& serverMessage);
+  IRCServerMessage (const char *serverMessage, int length);
+  IRCServerMessage (const QByteArray& buffer, int offset, int length);
 
-  bool isNumeric ()
+  bool isNumeric () const
   { return m_isNumeric; }
 
-  QString nick ()
-  { return m_nick; }
+  QString nick () const;
+  QString user () const;
+  QString host () const;
+  QString command () const;
 
-  QString command ()
-  { return m_command; }
+  /** The command classified at parse time, UnknownCode for numerics. */
+  IRCCommand::Code commandCode () const
+  { return m_commandCode; }
 
-  int numericValue ();
-  QString parameter (int index);
+  int numericValue () const;
+  int parameterCount () const
+  { return m_parameterCount; }
+  QString parameter (int index) const;
 
 private:
+  /** Position of a single piece of the message within the raw line. */
+  struct Span {
+    int offset;
+    int length;
+  };
+
+  void parse ();
+  QString decode (const Span& span) const;
+
+  QByteArray  m_serverMessage;
+  const char *m_data;
+  int         m_size;
   int         m_codeNumber;
   bool        m_isNumeric;
-  QString     m_nick;
-  QString     m_user;
-  QString     m_host;
-  QString     m_command;
-  QStringList m_parameters;
+  IRCCommand::Code m_commandCode;
+  Span        m_nick;
+  Span        m_user;
+  Span        m_host;
+  Span        m_command;
+  Span        m_parameters[MaximumParameters];
+  int         m_parameterCount;
 };
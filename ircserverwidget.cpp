@@ -34,6 +34,12 @@ IRCServerWidget::IRCServerWidget(IRCClient *ircClient, QWidget *parent) :
 
     connect(m_ircClient, SIGNAL(error(QString)),
             this, SLOT(handleErrorMessage(QString)));
+
+    connect(m_ircClient, SIGNAL(lagMeasured(int)),
+            this, SLOT(handleLagMeasured(int)));
+
+    connect(m_ircClient, SIGNAL(disconnected()),
+            this, SLOT(handleDisconnected()));
 }
 
 IRCServerWidget::~IRCServerWidget()
@@ -41,6 +47,11 @@ IRCServerWidget::~IRCServerWidget()
     delete ui;
 }
 
+IRCClient *IRCServerWidget::ircClient()
+{
+    return m_ircClient;
+}
+
 void IRCServerWidget::handleNotification(QString sender, QString message)
 {
     ui->serverTextEdit->append(sender + ": " + message);
@@ -55,3 +66,18 @@ void IRCServerWidget::handleErrorMessage(QString message)
 {
     ui->serverTextEdit->append(message);
 }
+
+void IRCServerWidget::handleLagMeasured(int milliseconds)
+{
+    const IRCLagStatistics& statistics = m_ircClient->lagStatistics();
+    ui->lagLabel->setText(QString("Lag: %1 ms (median %2 ms, 99%: %3 ms, max %4 ms)")
+                          .arg(milliseconds)
+                          .arg(statistics.median())
+                          .arg(statistics.percentile(99))
+                          .arg(statistics.maximum()));
+}
+
+void IRCServerWidget::handleDisconnected()
+{
+    ui->lagLabel->setText("Lag: unknown");
+}
@@ -34,10 +34,14 @@ public:
     explicit IRCServerWidget(IRCClient *ircClient, QWidget *parent = 0);
     ~IRCServerWidget();
 
+    IRCClient *ircClient();
+
 public slots:
     void handleNotification(QString sender, QString message);
     void handleDebugMessage(QString message);
     void handleErrorMessage(QString message);
+    void handleLagMeasured(int milliseconds);
+    void handleDisconnected();
 
 private:
     Ui::IRCServerWidget *ui;
@@ -0,0 +1,233 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "irctrace.h"
+
+// Qt includes
+#include <QFile>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QList>
+
+#ifdef QTIRC_TRACE
+namespace {
+
+struct Event {
+    const char *name;
+    qint64      begin;
+    qint64      end;
+};
+
+/**
+  * Where an event is kept in a ring. The sequence is the number of the
+  * event plus one once the slot holds all of it, and zero while the owning
+  * thread writes it.
+  */
+struct Slot {
+    QAtomicInteger<quint64>     sequence;
+    QAtomicPointer<const char>  name;
+    QAtomicInteger<qint64>      begin;
+    QAtomicInteger<qint64>      end;
+};
+
+/**
+  * Events of one thread. Only the owning thread writes; it publishes each
+  * event by advancing head. Readers check the sequence of a slot before and
+  * after copying it, and drop the event if the thread has reused the slot
+  * in the meantime.
+  */
+struct Ring {
+    Ring(int id, const QString& name)
+        : id(id), name(name), head(0) { }
+
+    int                     id;
+    QString                 name;
+    Slot                    events[IRCTrace::RingCapacity];
+    QAtomicInteger<quint64> head;
+};
+
+/** All rings ever created. Rings outlive their threads. */
+struct Registry {
+    QMutex        mutex;
+    QList<Ring*>  rings;
+};
+
+Registry &
+registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+const QElapsedTimer &
+traceClock()
+{
+    static QElapsedTimer clock;
+    static bool started = (clock.start(), true);
+    Q_UNUSED(started);
+    return clock;
+}
+
+thread_local Ring *currentRing = 0;
+
+Ring *
+ring()
+{
+    if(!currentRing)
+    {
+        Registry &shared = registry();
+        QMutexLocker locker(&shared.mutex);
+        QString name = QThread::currentThread()->objectName();
+        if(name.isEmpty())
+            name = QString("Thread %1").arg(shared.rings.size());
+        currentRing = new Ring(shared.rings.size(), name);
+        shared.rings.append(currentRing);
+    }
+    return currentRing;
+}
+
+QByteArray
+jsonString(const QString &string)
+{
+    QByteArray json("\"");
+    foreach(QChar c, string)
+    {
+        if(c == '"' || c == '\\')
+            json.append('\\').append(c.toLatin1());
+        else if(c.unicode() < 0x20)
+            json.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')).toLatin1());
+        else
+            json.append(QString(c).toUtf8());
+    }
+    return json.append('"');
+}
+
+}
+
+namespace IRCTrace {
+
+qint64
+now()
+{
+    return traceClock().nsecsElapsed();
+}
+
+void
+record(const char *name, qint64 begin, qint64 end)
+{
+    Ring *events = ring();
+    quint64 head = events->head.load();
+    Slot &slot = events->events[head % RingCapacity];
+    slot.sequence.fetchAndStoreAcquire(0);
+    slot.name.store(name);
+    slot.begin.store(begin);
+    slot.end.store(end);
+    slot.sequence.storeRelease(head + 1);
+    events->head.storeRelease(head + 1);
+}
+
+}
+#endif
+
+namespace IRCTrace {
+
+bool
+isEnabled()
+{
+#ifdef QTIRC_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray
+chromeTrace()
+{
+#ifdef QTIRC_TRACE
+    QList<Ring*> rings;
+    {
+        QMutexLocker locker(&registry().mutex);
+        rings = registry().rings;
+    }
+
+    QByteArray json("{\"traceEvents\":[\n");
+    bool first = true;
+    foreach(Ring *events, rings)
+    {
+        if(!first)
+            json.append(",\n");
+        first = false;
+        json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+        json.append(QByteArray::number(events->id));
+        json.append(",\"args\":{\"name\":").append(jsonString(events->name)).append("}}");
+
+        quint64 head = events->head.loadAcquire();
+        quint64 tail = head > quint64(RingCapacity) ? head - RingCapacity : 0;
+        QVector<Event> copy;
+        copy.reserve(int(head - tail));
+        for(quint64 i = tail; i < head; i++)
+        {
+            // The thread may be writing the slot or have moved on to a newer
+            // event in it, before or while it is copied.
+            Slot &slot = events->events[i % RingCapacity];
+            if(slot.sequence.loadAcquire() != i + 1)
+                continue;
+            Event event;
+            event.name = slot.name.load();
+            event.begin = slot.begin.load();
+            event.end = slot.end.load();
+            if(slot.sequence.fetchAndAddOrdered(0) != i + 1)
+                continue;
+            copy.append(event);
+        }
+
+        for(int i = 0; i < copy.size(); i++)
+        {
+            const Event &event = copy.at(i);
+            json.append(",\n{\"name\":").append(jsonString(QString::fromUtf8(event.name)));
+            json.append(",\"ph\":\"X\",\"pid\":1,\"tid\":").append(QByteArray::number(events->id));
+            json.append(",\"ts\":").append(QByteArray::number(event.begin / 1000.0, 'f', 3));
+            json.append(",\"dur\":").append(QByteArray::number((event.end - event.begin) / 1000.0, 'f', 3));
+            json.append('}');
+        }
+    }
+    return json.append("\n]}\n");
+#else
+    return QByteArray();
+#endif
+}
+
+bool
+writeChromeTrace(const QString &fileName)
+{
+    if(!isEnabled())
+        return false;
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(chromeTrace()) >= 0;
+}
+
+}
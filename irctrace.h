@@ -0,0 +1,80 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Qt includes
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+/**
+  * Scoped trace points. IRC_TRACE_SCOPE("name") records when the enclosing
+  * scope was entered and how long it took. Without QTIRC_TRACE, which
+  * CONFIG += qtirc_trace defines, trace points compile to nothing.
+  *
+  * Each thread records into a ring buffer of its own without taking a lock,
+  * keeping the most recent RingCapacity events. The rings of all threads
+  * can be written out in the trace event format of Chrome, to be opened
+  * with chrome://tracing or Perfetto. Names have to be string literals.
+  */
+namespace IRCTrace {
+
+/** Number of events each thread keeps. */
+const int RingCapacity = 16384;
+
+/** Whether trace points have been compiled in. */
+bool isEnabled();
+
+/** The events recorded so far as trace event JSON, empty when disabled. */
+QByteArray chromeTrace();
+
+/** Writes chromeTrace() to \a fileName. Fails when tracing is disabled. */
+bool writeChromeTrace(const QString& fileName);
+
+#ifdef QTIRC_TRACE
+/** Nanoseconds on a monotonic clock shared by all threads. */
+qint64 now();
+
+/** Records an event of the calling thread. */
+void record(const char *name, qint64 begin, qint64 end);
+
+class Scope {
+public:
+    explicit Scope(const char *name)
+        : m_name(name), m_begin(now()) { }
+    ~Scope()
+    { record(m_name, m_begin, now()); }
+
+private:
+    Q_DISABLE_COPY(Scope)
+
+    const char *m_name;
+    qint64      m_begin;
+};
+#endif
+
+}
+
+#ifdef QTIRC_TRACE
+#define IRC_TRACE_CONCAT_(a, b) a##b
+#define IRC_TRACE_CONCAT(a, b) IRC_TRACE_CONCAT_(a, b)
+#define IRC_TRACE_SCOPE(name) \
+    IRCTrace::Scope IRC_TRACE_CONCAT(ircTraceScope, __LINE__)(name)
+#else
+#define IRC_TRACE_SCOPE(name) do { } while(0)
+#endif
@@ -0,0 +1,249 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Own includes
+#include "ircuserlistmodel.h"
+
+// Standard includes
+#include <algorithm>
+#include <string.h>
+
+namespace {
+/** Channel status prefixes, from the highest to the lowest. */
+const char ModePrefixes[] = "~&@%+";
+const int NoModeRank = sizeof(ModePrefixes) - 1;
+}
+
+IRCUserListModel::IRCUserListModel(IRCAtomTable *atomTable, QObject *parent) :
+    QAbstractListModel(parent)
+{
+    m_atomTable = atomTable;
+}
+
+IRCUserListModel::~IRCUserListModel()
+{
+    for(int row = 0; row < m_users.size(); row++)
+        m_atomTable->release(m_users.at(row).atom);
+}
+
+int
+IRCUserListModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+        return 0;
+    return m_users.size();
+}
+
+QVariant
+IRCUserListModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= m_users.size())
+        return QVariant();
+
+    const User &user = m_users.at(index.row());
+    if(role == Qt::DisplayRole)
+    {
+        if(user.rank == NoModeRank)
+            return user.nick;
+        return modePrefix(user.rank) + user.nick;
+    }
+    return QVariant();
+}
+
+void
+IRCUserListModel::setUsers(const QStringList &nicks)
+{
+    beginResetModel();
+    QVector<User> previousUsers;
+    previousUsers.swap(m_users);
+    m_ranks.clear();
+    m_users.reserve(nicks.size());
+    foreach(const QString &nick, nicks)
+    {
+        User user = makeUser(nick);
+        if(user.nick.isEmpty())
+            continue;
+        if(m_ranks.contains(user.atom))
+        {
+            m_atomTable->release(user.atom);
+            continue;
+        }
+        m_ranks.insert(user.atom, user.rank);
+        m_users.append(user);
+    }
+    std::sort(m_users.begin(), m_users.end(), lessThan);
+    endResetModel();
+
+    // Users that are still there have been retained again by now, so their
+    // atoms stay the same.
+    for(int row = 0; row < previousUsers.size(); row++)
+        m_atomTable->release(previousUsers.at(row).atom);
+}
+
+void
+IRCUserListModel::addUser(const QString &nick)
+{
+    User user = makeUser(nick);
+    if(user.nick.isEmpty())
+        return;
+
+    QHash<int, int>::const_iterator it = m_ranks.constFind(user.atom);
+    if(it != m_ranks.constEnd())
+    {
+        if(it.value() == user.rank)
+        {
+            m_atomTable->release(user.atom);
+            return;
+        }
+        removeUser(user.atom);
+    }
+    insertUser(user);
+}
+
+bool
+IRCUserListModel::removeUser(int nickAtom)
+{
+    int row = indexOf(nickAtom);
+    if(row < 0)
+        return false;
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_users.remove(row);
+    m_ranks.remove(nickAtom);
+    endRemoveRows();
+    m_atomTable->release(nickAtom);
+    return true;
+}
+
+bool
+IRCUserListModel::renameUser(int oldNickAtom, const QString &newNick)
+{
+    int row = indexOf(oldNickAtom);
+    if(row < 0)
+        return false;
+
+    User user = m_users.at(row);
+    user.nick = newNick;
+    user.key = m_atomTable->fold(newNick);
+    user.atom = m_atomTable->retain(newNick);
+
+    if(user.atom != oldNickAtom && m_ranks.contains(user.atom))
+        removeUser(user.atom);
+    row = indexOf(oldNickAtom);
+
+    // A rename that keeps the position only changes the row's data.
+    int target = lowerBound(user);
+    if(target == row || target == row + 1)
+    {
+        m_users[row] = user;
+        m_ranks.remove(oldNickAtom);
+        m_ranks.insert(user.atom, user.rank);
+        m_atomTable->release(oldNickAtom);
+        emit dataChanged(index(row), index(row));
+        return true;
+    }
+
+    removeUser(oldNickAtom);
+    insertUser(user);
+    return true;
+}
+
+int
+IRCUserListModel::indexOf(int nickAtom) const
+{
+    QHash<int, int>::const_iterator it = m_ranks.constFind(nickAtom);
+    if(it == m_ranks.constEnd())
+        return -1;
+
+    User user;
+    user.rank = it.value();
+    user.key = m_atomTable->fold(m_atomTable->name(nickAtom));
+    int row = lowerBound(user);
+    if(row < m_users.size() && m_users.at(row).atom == nickAtom)
+        return row;
+    return -1;
+}
+
+QStringList
+IRCUserListModel::users() const
+{
+    QStringList nicks;
+    for(int row = 0; row < m_users.size(); row++)
+        nicks.append(data(index(row)).toString());
+    return nicks;
+}
+
+QString
+IRCUserListModel::splitModePrefix(const QString &nick, int *rank)
+{
+    // Names replies prefix the nicks of privileged users with their status.
+    // With multi-prefix there may be several, the first one is the highest.
+    int highest = NoModeRank;
+    int i = 0;
+    for(; i < nick.size(); i++)
+    {
+        const char *prefix = strchr(ModePrefixes, nick.at(i).toLatin1());
+        if(!prefix || !*prefix)
+            break;
+        highest = qMin(highest, int(prefix - ModePrefixes));
+    }
+    if(rank)
+        *rank = highest;
+    return nick.mid(i);
+}
+
+bool
+IRCUserListModel::lessThan(const User &left, const User &right)
+{
+    if(left.rank != right.rank)
+        return left.rank < right.rank;
+    return left.key < right.key;
+}
+
+QChar
+IRCUserListModel::modePrefix(int rank)
+{
+    return QLatin1Char(ModePrefixes[rank]);
+}
+
+IRCUserListModel::User
+IRCUserListModel::makeUser(const QString &nick)
+{
+    User user;
+    user.nick = splitModePrefix(nick, &user.rank);
+    user.key = m_atomTable->fold(user.nick);
+    user.atom = user.nick.isEmpty() ? int(IRCAtomTable::InvalidAtom)
+                                    : m_atomTable->retain(user.nick);
+    return user;
+}
+
+int
+IRCUserListModel::lowerBound(const User &user) const
+{
+    return std::lower_bound(m_users.constBegin(), m_users.constEnd(),
+                            user, lessThan) - m_users.constBegin();
+}
+
+void
+IRCUserListModel::insertUser(const User &user)
+{
+    int row = lowerBound(user);
+    beginInsertRows(QModelIndex(), row, row);
+    m_users.insert(row, user);
+    m_ranks.insert(user.atom, user.rank);
+    endInsertRows();
+}
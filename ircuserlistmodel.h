@@ -0,0 +1,94 @@
+/* QtIRC - Qt based IRC client
+ * Copyright (C) 2012-2015 Jacob Dawid (jacob@omg-it.works)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Own includes
+#include "ircatomtable.h"
+
+// Qt includes
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+
+/**
+  * \class IRCUserListModel
+  * Sorted list of the users in a channel. Users with a higher channel
+  * status come first, the rest is ordered by their folded nick. Users are
+  * looked up by binary search and every change is announced with row
+  * insertions and removals rather than a model reset, so views only
+  * update what actually changed.
+  *
+  * The model holds a reference to the atom of every listed nick, so nicks
+  * that have left every channel give their atom back.
+  */
+class IRCUserListModel :
+        public QAbstractListModel {
+    Q_OBJECT
+public:
+    IRCUserListModel(IRCAtomTable *atomTable, QObject *parent = 0);
+    ~IRCUserListModel();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    /**
+      * Replaces all users. \a nicks may carry mode prefixes as sent in
+      * names replies. This resets the model once.
+      */
+    void setUsers(const QStringList& nicks);
+
+    /**
+      * Adds a user, which may carry a mode prefix. A user that is already
+      * listed only has its mode prefix updated.
+      */
+    void addUser(const QString& nick);
+
+    /** Removes the user with \a nickAtom, returns false if not listed. */
+    bool removeUser(int nickAtom);
+
+    /** Renames the user with \a oldNickAtom, keeping its mode prefix. */
+    bool renameUser(int oldNickAtom, const QString& newNick);
+
+    /** Returns the row of the user with \a nickAtom, or -1. */
+    int indexOf(int nickAtom) const;
+
+    /** Nicks of all users, with their mode prefixes. */
+    QStringList users() const;
+
+    /** Strips the mode prefix of \a nick and returns its rank in \a rank. */
+    static QString splitModePrefix(const QString& nick, int *rank = 0);
+
+private:
+    struct User {
+        int     rank;
+        QString key;
+        QString nick;
+        int     atom;
+    };
+
+    static bool lessThan(const User& left, const User& right);
+    static QChar modePrefix(int rank);
+    User makeUser(const QString& nick);
+    int lowerBound(const User& user) const;
+    void insertUser(const User& user);
+
+    IRCAtomTable *      m_atomTable;
+    QVector<User>       m_users;
+    QHash<int, int>     m_ranks;
+};
@@ -29,12 +29,11 @@
 IRCWidget::IRCWidget(QWidget *parent) :
     QWidget(parent)
 {
-    _ircClient = new IRCClient;
+    // Servers are read and pings answered in network threads, so a busy
+    // user interface does not hold them up.
+    _connectionManager = new IRCConnectionManager;
     _tabWidget = new QTabWidget;
 
-    _ircServerWidget = new IRCServerWidget(_ircClient);
-    _tabWidget->addTab(_ircServerWidget, tr("Server"));
-
     QWidget *messageWidget = new QWidget;
     _pushButtonNick = new QPushButton;
     _pushButtonNick->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Minimum);
@@ -59,20 +58,45 @@ IRCWidget::IRCWidget(QWidget *parent) :
 
     connect(_pushButtonNick, SIGNAL(clicked()), this, SLOT(showChangeUserNickPopup()));
     connect(_chatMessageTextEdit, SIGNAL(sendMessage(QString)), this, SLOT(sendMessage(QString)));
-    connect(_ircClient, SIGNAL(loggedIn(QString)), this, SLOT(handleConnected(QString)));
-
-    _autoJoinChannel = QString();
+    connect(_tabWidget, SIGNAL(currentChanged(int)), this, SLOT(updateNickButton()));
 }
 
 IRCWidget::~IRCWidget()
 {
 
-    delete _ircClient;
+    delete _connectionManager;
+}
+
+IRCConnectionManager *IRCWidget::connectionManager()
+{
+    return _connectionManager;
+}
+
+IRCClient *IRCWidget::currentClient()
+{
+    QWidget *widget = _tabWidget->currentWidget();
+    IRCServerWidget *ircServerWidget = dynamic_cast<IRCServerWidget*>(widget);
+    if(ircServerWidget) {
+        return ircServerWidget->ircClient();
+    }
+    IRCChannelWidget *ircChannelWidget = dynamic_cast<IRCChannelWidget*>(widget);
+    if(ircChannelWidget && ircChannelWidget->ircChannelProxy()) {
+        return ircChannelWidget->ircChannelProxy()->ircClient();
+    }
+    return 0;
 }
 
 void IRCWidget::joinChannel(QString channel)
 {
-    IRCChannel *ircChannel = _ircClient->ircChannel(channel);
+    IRCClient *ircClient = currentClient();
+    if(ircClient) {
+        joinChannel(ircClient, channel);
+    }
+}
+
+void IRCWidget::joinChannel(IRCClient *ircClient, QString channel)
+{
+    IRCChannel *ircChannel = ircClient->ircChannel(channel);
     if(!_channels.contains(ircChannel)) {
         _channels.insert(ircChannel);
 
@@ -89,26 +113,35 @@ void IRCWidget::connectToServer(QString nick,
                                 quint16 port,
                                 QString autoJoinChannel)
 {
-    _autoJoinChannel = autoJoinChannel;
+    IRCClient *ircClient = _connectionManager->addClient();
+    _autoJoinChannels.insert(ircClient, autoJoinChannel);
+    connect(ircClient, SIGNAL(loggedIn(QString)), this, SLOT(handleConnected(QString)));
+    connect(ircClient, SIGNAL(userNicknameChanged(QString)), this, SLOT(updateNickButton()));
+
+    IRCServerWidget *ircServerWidget = new IRCServerWidget(ircClient);
+    int tabIndex = _tabWidget->addTab(ircServerWidget, url);
+    _tabWidget->setCurrentIndex(tabIndex);
     _pushButtonNick->setText(nick);
 
-    QHostInfo hostInfo = QHostInfo::fromName(url);
-    QList<QHostAddress> hostAddresses = hostInfo.addresses();
-    if(hostAddresses.isEmpty()) {
-    } else {
-        _ircClient->connectToHost(hostAddresses.at(0), port, nick);
-    }
+    // Resolving and connecting happens in the background. Failures are
+    // reported through the error signal of the client.
+    ircClient->connectToHost(url, port, nick);
 }
 
 void IRCWidget::showChangeUserNickPopup()
 {
+    IRCClient *ircClient = currentClient();
+    if(!ircClient) {
+        return;
+    }
+
     bool ok;
     QString newNick =
             QInputDialog::getText(this, QString("Nickname"),
                                    QString("Type in your nickname:"),
-                                   QLineEdit::Normal, _ircClient->nickname(), &ok);
+                                   QLineEdit::Normal, ircClient->nickname(), &ok);
     if(ok) {
-        _ircClient->sendNicknameChangeRequest(newNick);
+        ircClient->sendNicknameChangeRequest(newNick);
     }
 }
 
@@ -128,9 +161,9 @@ void IRCWidget::sendMessage(QString message)
 
         if(command == "/join" || command == "/j") {
             joinChannel(line.at(1));
-        } else if(command == "/nick") {
-            _ircClient->sendNicknameChangeRequest(line.at(1));
-        } else if(command == "/msg") {
+        } else if(command == "/nick" && currentClient()) {
+            currentClient()->sendNicknameChangeRequest(line.at(1));
+        } else if(command == "/msg" && currentClient()) {
             QString recipient = line.at(1);
             // Since we splitted the message before, we have to glue it together again.
             QString pmsg = "";
@@ -138,7 +171,7 @@ void IRCWidget::sendMessage(QString message)
                 pmsg += line.at(i);
                 pmsg += " ";
             }
-            _ircClient->sendPrivateMessage(recipient, pmsg);
+            currentClient()->sendPrivateMessage(recipient, pmsg);
         }
     } else { // Not a command.
         QWidget *widget = _tabWidget->currentWidget();
@@ -159,8 +192,17 @@ void IRCWidget::sendMessage(QString message)
 void IRCWidget::handleConnected(QString server)
 {
     Q_UNUSED(server);
-    if(!_autoJoinChannel.isEmpty()) {
-        joinChannel(_autoJoinChannel);
+    IRCClient *ircClient = qobject_cast<IRCClient*>(sender());
+    if(ircClient && !_autoJoinChannels.value(ircClient).isEmpty()) {
+        joinChannel(ircClient, _autoJoinChannels.value(ircClient));
     }
     emit connected();
 }
+
+void IRCWidget::updateNickButton()
+{
+    IRCClient *ircClient = currentClient();
+    if(ircClient && !ircClient->nickname().isEmpty()) {
+        _pushButtonNick->setText(ircClient->nickname());
+    }
+}
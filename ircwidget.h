@@ -19,12 +19,14 @@
 
 // Own includes
 #include "ircclient.h"
+#include "ircconnectionmanager.h"
 #include "ircserverwidget.h"
 #include "chatmessagetextedit.h"
 
 // Qt includes
 #include <QWidget>
 #include <QSet>
+#include <QHash>
 #include <QSplitter>
 #include <QTabWidget>
 #include <QPushButton>
@@ -36,17 +38,29 @@ public:
     explicit IRCWidget(QWidget *parent = 0);
     ~IRCWidget();
 
+    /**
+      * Connects to another server. Every server gets a tab of its own, next
+      * to the tabs of its channels.
+      */
     void connectToServer(QString nick,
                          QString url,
                          quint16 port = 6667,
                          QString autoJoinChannel = QString());
 
+    /** Joins \a channel on the server of the current tab. */
     void joinChannel(QString channel);
+    void joinChannel(IRCClient *ircClient, QString channel);
+
+    IRCConnectionManager *connectionManager();
+
+    /** The client of the current tab. */
+    IRCClient *currentClient();
 
 public slots:
     void showChangeUserNickPopup();
     void sendMessage(QString message);
     void handleConnected(QString server);
+    void updateNickButton();
 
 signals:
     void connected();
@@ -55,9 +69,8 @@ private:
     QSplitter *             _splitter;
     QTabWidget *            _tabWidget;
     QPushButton *           _pushButtonNick;
-    IRCClient *             _ircClient;
-    IRCServerWidget *       _ircServerWidget;
+    IRCConnectionManager *  _connectionManager;
     ChatMessageTextEdit *   _chatMessageTextEdit;
     QSet<IRCChannel*>       _channels;
-    QString                 _autoJoinChannel;
+    QHash<IRCClient*, QString> _autoJoinChannels;
 };
@@ -0,0 +1,51 @@
+# Trace points are compiled in with CONFIG += qtirc_trace, see irctrace.h.
+qtirc_trace {
+    DEFINES += QTIRC_TRACE
+}
+
+HEADERS += \
+    $$PWD/ircatomtable.h \
+    $$PWD/irccapture.h \
+    $$PWD/ircchannel.h \
+    $$PWD/ircchannellog.h \
+    $$PWD/ircclient.h \
+    $$PWD/ircclientmetrics.h \
+    $$PWD/irccodes.h \
+    $$PWD/irccommand.h \
+    $$PWD/ircconnection.h \
+    $$PWD/ircconnectionmanager.h \
+    $$PWD/ircconnector.h \
+    $$PWD/ircerror.h \
+    $$PWD/irclagstatistics.h \
+    $$PWD/ircmetricsexporter.h \
+    $$PWD/ircreceivebuffer.h \
+    $$PWD/ircreplaydevice.h \
+    $$PWD/ircreply.h \
+    $$PWD/ircsearchindex.h \
+    $$PWD/ircsearchresultmodel.h \
+    $$PWD/ircsendqueue.h \
+    $$PWD/ircservermessage.h \
+    $$PWD/irctrace.h \
+    $$PWD/ircuserlistmodel.h
+
+SOURCES += \
+    $$PWD/ircatomtable.cpp \
+    $$PWD/irccapture.cpp \
+    $$PWD/ircchannel.cpp \
+    $$PWD/ircchannellog.cpp \
+    $$PWD/ircclient.cpp \
+    $$PWD/ircclientmetrics.cpp \
+    $$PWD/irccommand.cpp \
+    $$PWD/ircconnection.cpp \
+    $$PWD/ircconnectionmanager.cpp \
+    $$PWD/ircconnector.cpp \
+    $$PWD/irclagstatistics.cpp \
+    $$PWD/ircmetricsexporter.cpp \
+    $$PWD/ircreceivebuffer.cpp \
+    $$PWD/ircreplaydevice.cpp \
+    $$PWD/ircsearchindex.cpp \
+    $$PWD/ircsearchresultmodel.cpp \
+    $$PWD/ircsendqueue.cpp \
+    $$PWD/ircservermessage.cpp \
+    $$PWD/irctrace.cpp \
+    $$PWD/ircuserlistmodel.cpp
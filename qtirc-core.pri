@@ -0,0 +1,7 @@
+INCLUDEPATH += \
+    $$PWD
+
+LIBS += \
+    -L../qtirc -lqtirc-core
+
+QT += network
@@ -0,0 +1,9 @@
+QT = core network
+
+TEMPLATE = lib
+
+TARGET = qtirc-core
+
+CONFIG += staticlib c++11
+
+include(qtirc-core-sources.pri)
@@ -2,27 +2,27 @@ QT += network gui widgets
 
 TEMPLATE = lib
 
-CONFIG += staticlib
+CONFIG += staticlib c++11
+
+include(qtirc-core-sources.pri)
 
 HEADERS += \
     chatmessagetextedit.h \
-    irccodes.h \
-    irccommand.h \
-    ircerror.h \
-    ircreply.h \
-    ircservermessage.h \
+    ircchanneldocument.h \
+    ircmessagedelegate.h \
+    ircmessagemodel.h \
+    ircnickformatcache.h \
     ircwidget.h \
-    ircchannel.h \
-    ircclient.h \
     ircchannelwidget.h \
     ircserverwidget.h
 
 SOURCES += \
     chatmessagetextedit.cpp \
-    ircservermessage.cpp \
+    ircchanneldocument.cpp \
+    ircmessagedelegate.cpp \
+    ircmessagemodel.cpp \
+    ircnickformatcache.cpp \
     ircwidget.cpp \
-    ircchannel.cpp \
-    ircclient.cpp \
     ircchannelwidget.cpp \
     ircserverwidget.cpp
 